@@ -0,0 +1,342 @@
+/*
+ * File Name: access_profile.c
+ * Date October 19 2026
+ * Module Info: This module profiles how the program uses D-memory. The memory controller passes every data read and
+ * write to it while profiling is on, and it keeps three views of them, all in fixed size arrays so a profile of a
+ * full length run costs the same memory as one of a short run:
+ *   - reads and writes per 16 byte line
+ *   - per LD/ST/LDR/STR instruction the stride between its successive accesses and how often it stayed constant,
+ *     with the auto-increment or auto-decrement mode it used
+ *   - a histogram of reuse distances, the number of distinct lines accessed between two accesses to the same line
+ *
+ * Reuse distances come from a Fenwick tree over access positions holding a 1 at the position of each line's most
+ * recent access, the distance is the count of ones after the line's previous position. There are never more ones
+ * than lines, so when the positions run out they are renumbered in order, keeping the tree at a fixed size.
+ * A distance of d means a fully associative LRU cache of more than d lines would have hit, so the report also
+ * gives the hit rate of such caches of each size.
+ */
+#include "emulation.h"
+
+#define ACCESS_REPORT_ROWS 20
+#define ACCESS_LINE_BYTES (1 << ACCESS_LINE_SHIFT)
+#define PERCENT(part, whole) ((whole) ? (100.0 * (double)(part) / (double)(whole)) : 0.0)
+
+/*
+ * @brief This function starts profiling, clearing anything recorded before
+ * @return false if the profile could not be allocated
+ */
+bool enable_access_profile(Emulator *emulator)
+{
+    AccessProfile *profile;
+    disable_access_profile(emulator);
+    profile = calloc(1, sizeof(AccessProfile));
+    if (profile == NULL || (profile->sites = calloc(WORD_MEMORY_SIZE, sizeof(AccessSite))) == NULL)
+    {
+        free(profile);
+        return false;
+    }
+    emulator->access_profile = profile;
+    return true;
+}
+
+void disable_access_profile(Emulator *emulator)
+{
+    if (emulator->access_profile != NULL)
+    {
+        free(emulator->access_profile->sites);
+        free(emulator->access_profile);
+        emulator->access_profile = NULL;
+    }
+}
+
+static void add_to_tree(unsigned int *tree, unsigned int position, int delta)
+{
+    for (; position <= REUSE_POSITIONS; position += position & -position)
+    {
+        tree[position] += delta;
+    }
+}
+
+static unsigned int count_to(const unsigned int *tree, unsigned int position)
+{
+    unsigned int count = 0;
+    for (; position > 0; position -= position & -position)
+    {
+        count += tree[position];
+    }
+    return count;
+}
+
+/*
+ * @brief This function renumbers the last accesses 1, 2, 3... in the order they happened and rebuilds the tree
+ */
+static void renumber_positions(AccessProfile *profile)
+{
+    unsigned int kept = 0;
+    unsigned short line;
+    unsigned int parent;
+    for (unsigned int position = 1; position <= profile->position; ++position)
+    {
+        line = profile->line_at[position];
+        if (profile->last_use[line] == position)
+        {
+            profile->last_use[line] = ++kept;
+            profile->line_at[kept] = line;
+        }
+    }
+    memset(profile->reuse_tree, 0, sizeof(profile->reuse_tree));
+    //every kept position holds a 1, each node passes its total up to its parent, including nodes past the kept
+    //positions so the totals reach the nodes covering the positions still to come
+    for (unsigned int position = 1; position <= REUSE_POSITIONS; ++position)
+    {
+        profile->reuse_tree[position] += position <= kept;
+        parent = position + (position & -position);
+        if (parent <= REUSE_POSITIONS)
+        {
+            profile->reuse_tree[parent] += profile->reuse_tree[position];
+        }
+    }
+    profile->position = kept;
+}
+
+static void record_reuse(AccessProfile *profile, unsigned short line)
+{
+    unsigned int last = profile->last_use[line];
+    unsigned int distance;
+    if (profile->position == REUSE_POSITIONS)
+    {
+        renumber_positions(profile);
+        last = profile->last_use[line];
+    }
+    if (last == 0)
+    {
+        profile->cold++;
+    }
+    else
+    {
+        distance = count_to(profile->reuse_tree, profile->position) - count_to(profile->reuse_tree, last);
+        profile->reuse[distance ? 32 - __builtin_clz(distance) : 0]++;
+        add_to_tree(profile->reuse_tree, last, -1);
+    }
+    profile->position++;
+    add_to_tree(profile->reuse_tree, profile->position, 1);
+    profile->last_use[line] = profile->position;
+    profile->line_at[profile->position] = line;
+}
+
+/*
+ * @brief This function records the data access the memory controller is about to make, the LD/ST making it is
+ * still the instruction at execute_address during E1
+ */
+void profile_access(Emulator *emulator)
+{
+    AccessProfile *profile = emulator->access_profile;
+    unsigned short address = emulator->d_control.DMAR;
+    AccessSite *site = &profile->sites[emulator->execute_address >> 1];
+    short stride = (short)(address - site->last_address);
+    if (emulator->xCTRL == D_WRITE || emulator->xCTRL == D_WRITE_B)
+    {
+        profile->writes[address >> ACCESS_LINE_SHIFT]++;
+    }
+    else
+    {
+        profile->reads[address >> ACCESS_LINE_SHIFT]++;
+    }
+    //the first access sets the address, the second the stride, from the third on the stride can repeat
+    if (site->accesses > 1 && stride == site->stride)
+    {
+        site->constant++;
+    }
+    if (site->accesses > 0)
+    {
+        site->stride = stride;
+    }
+    site->last_address = address;
+    site->opcode = emulator->opcode;
+    site->mode = emulator->inst_operands;
+    site->accesses++;
+    profile->accesses++;
+    record_reuse(profile, address >> ACCESS_LINE_SHIFT);
+}
+
+static const char *access_opcode(const AccessSite *site)
+{
+    switch (site->opcode)
+    {
+        case ld:
+            return site->mode.word_or_byte ? "LD.B" : "LD";
+        case st:
+            return site->mode.word_or_byte ? "ST.B" : "ST";
+        case ldr:
+            return site->mode.word_or_byte ? "LDR.B" : "LDR";
+        default:
+            return site->mode.word_or_byte ? "STR.B" : "STR";
+    }
+}
+
+static const char *access_mode(const AccessSite *site)
+{
+    if (site->opcode == ldr || site->opcode == str)
+    {
+        return "relative";
+    }
+    if (site->mode.inc)
+    {
+        return site->mode.prpo ? "pre-inc" : "post-inc";
+    }
+    if (site->mode.dec)
+    {
+        return site->mode.prpo ? "pre-dec" : "post-dec";
+    }
+    return "direct";
+}
+
+static const AccessProfile *sort_profile;
+static int compare_lines(const void *a, const void *b)
+{
+    unsigned short left_line = *(const unsigned short *)a;
+    unsigned short right_line = *(const unsigned short *)b;
+    unsigned int left = sort_profile->reads[left_line] + sort_profile->writes[left_line];
+    unsigned int right = sort_profile->reads[right_line] + sort_profile->writes[right_line];
+    return left < right ? 1 : left > right ? -1 : 0;
+}
+
+static int compare_sites(const void *a, const void *b)
+{
+    unsigned long int left = sort_profile->sites[*(const unsigned short *)a].accesses;
+    unsigned long int right = sort_profile->sites[*(const unsigned short *)b].accesses;
+    return left < right ? 1 : left > right ? -1 : 0;
+}
+
+static void print_hottest_lines(const AccessProfile *profile, unsigned short *ranked)
+{
+    int lines = 0;
+    for (int i = 0; i < ACCESS_LINES; ++i)
+    {
+        if (profile->reads[i] || profile->writes[i])
+        {
+            ranked[lines++] = (unsigned short)i;
+        }
+    }
+    sort_profile = profile;
+    qsort(ranked, lines, sizeof(unsigned short), compare_lines);
+    printf("== D-Memory Access Profile (%lu accesses, %d lines of %d bytes touched) ==\n", profile->accesses, lines,
+           ACCESS_LINE_BYTES);
+    printf("-- Lines --\nLINE        READS       WRITES\n");
+    for (int i = 0; i < lines && i < ACCESS_REPORT_ROWS; ++i)
+    {
+        printf("%04X..%04X  %-10u  %u\n", ranked[i] << ACCESS_LINE_SHIFT,
+               ((ranked[i] + 1) << ACCESS_LINE_SHIFT) - 1, profile->reads[ranked[i]], profile->writes[ranked[i]]);
+    }
+}
+
+static void print_access_sites(Emulator *emulator, const AccessProfile *profile, unsigned short *ranked)
+{
+    int sites = 0;
+    const AccessSite *site;
+    for (int i = 0; i < (WORD_MEMORY_SIZE); ++i)
+    {
+        if (profile->sites[i].accesses)
+        {
+            ranked[sites++] = (unsigned short)i;
+        }
+    }
+    sort_profile = profile;
+    qsort(ranked, sites, sizeof(unsigned short), compare_sites);
+    printf("-- Load/Store Sites --\nADDR  OP     MODE      ACCESSES    STRIDE  CONSTANT\n");
+    for (int i = 0; i < sites && i < ACCESS_REPORT_ROWS; ++i)
+    {
+        site = &profile->sites[ranked[i]];
+        printf("%04X  %-6s %-9s %-11lu ", ranked[i] << 1, access_opcode(site), access_mode(site),
+               site->accesses);
+        if (site->accesses < 2)
+        {
+            printf("-       -     ");
+        }
+        else
+        {
+            //the stride of the last two accesses, and how many of the strides after the first one repeated it
+            printf("%-7d %5.1f%%", site->stride,
+                   site->accesses > 2 ? PERCENT(site->constant, site->accesses - 2) : 100.0);
+        }
+        printf("%s\n", symbol_suffix(emulator, (unsigned short)(ranked[i] << 1)));
+    }
+}
+
+static void print_reuse_distances(const AccessProfile *profile)
+{
+    unsigned long int hits = 0;
+    char range[16];
+    printf("-- Reuse Distance (distinct lines between accesses to a line) --\n");
+    printf("DISTANCE     ACCESSES      SHARE   LRU CACHE  HIT RATE\n");
+    for (int bucket = 0; bucket < REUSE_BUCKETS; ++bucket)
+    {
+        hits += profile->reuse[bucket];
+        if (bucket < 2)
+        {
+            snprintf(range, sizeof(range), "%d", bucket);
+        }
+        else
+        {
+            snprintf(range, sizeof(range), "%d-%d", 1 << (bucket - 1), (1 << bucket) - 1);
+        }
+        //a fully associative LRU cache of 2^bucket lines hits every distance up to and including this bucket's
+        printf("%-12s %-13lu %5.1f%%  %-7d B  %5.1f%%\n", range, profile->reuse[bucket],
+               PERCENT(profile->reuse[bucket], profile->accesses), ACCESS_LINE_BYTES << bucket,
+               PERCENT(hits, profile->accesses));
+    }
+    printf("%-12s %-13lu %5.1f%%\n", "cold", profile->cold, PERCENT(profile->cold, profile->accesses));
+}
+
+/*
+ * @brief This function prints the busiest lines, the load and store sites with their strides and the reuse
+ * distance histogram
+ */
+void print_access_profile(Emulator *emulator)
+{
+    unsigned short *ranked = malloc((WORD_MEMORY_SIZE) * sizeof(unsigned short));
+    if (ranked == NULL)
+    {
+        printf("Failed to allocate memory for the access profile\n");
+        return;
+    }
+    print_hottest_lines(emulator->access_profile, ranked);
+    print_access_sites(emulator, emulator->access_profile, ranked);
+    print_reuse_distances(emulator->access_profile);
+    free(ranked);
+}
+
+/*
+ * @brief This function turns D-memory access profiling on or off and prints the profile
+ */
+void access_profile_menu(Emulator *emulator)
+{
+    char command;
+    printf("Enter E to start profiling D-memory accesses, O to stop, R for the report: ");
+    if (scanf(" %c", &command) != 1)
+    {
+        return;
+    }
+    switch (toupper(command))
+    {
+        case 'E':
+            printf(enable_access_profile(emulator) ? "Profiling D-memory accesses\n"
+                                                   : "Could not allocate the access profile\n");
+            break;
+        case 'O':
+            disable_access_profile(emulator);
+            printf("Access profiling off\n");
+            break;
+        case 'R':
+            if (emulator->access_profile == NULL)
+            {
+                printf("Accesses are not being profiled, enter E first\n");
+                break;
+            }
+            print_access_profile(emulator);
+            break;
+        default:
+            printf("Invalid access profile command\n");
+            break;
+    }
+}
@@ -0,0 +1,250 @@
+/*
+ * File Name: alu.c
+ * Date October 19 2026
+ * Module Info: This module implements the ALU kernels used by execute_arithmetic. Each kernel takes the destination,
+ * the source and the carry and returns the result and the new flags together, packed by ALU_OUT with the flags in
+ * their PSW bit positions, so the caller updates the PSW with one mask and OR instead of branching on the width.
+ *
+ * Byte ADD/ADDC/SUB/SUBC/CMP are looked up in tables built once by init_alu_tables, word ADD/ADDC/SUB/CMP take carry
+ * and overflow from the compiler's overflow builtins, and DADD forms all four digit sums in one word then adjusts
+ * them two digits at a time through a small table.
+ * Every kernel gives the results and flags of the update_psw and bcd_addition code it replaced bit for bit,
+ * including its quirks:
+ *   - Z is tested on the 16 bit intermediate result, so a byte result that carries or borrows out is never zero
+ *   - SUBC computes dest + ~src + 1 + C and takes C and V from the sign bits, the builtins would disagree when
+ *     that sum carries into bit 15 twice
+ *   - BIT, BIC and BIS shift 1 by the whole source with the count masked to 5 bits, which is what the original
+ *     1 << source compiles to on x86
+ *   - DADD adds each digit modulo 16 before adjusting it, treats a source of 16 or 32 as BCD 16 or 32, and DADD.B
+ *     clears the upper byte and can only set C, never clear it
+ */
+#include "emulation.h"
+
+#define WORD 0
+#define BYTE_VALUES 256
+#define BCD_LIMIT 9
+#define BCD_ADJUST 10
+#define BIT_MASK(source) (1u << ((source) & 31))
+#define TABLE_OUT(entry) ALU_OUT((entry) & 0xFF, (entry) >> 8)
+
+//[carry in][dest][source], result byte in the low byte and flags in the high byte
+static unsigned short byte_add_table[2][BYTE_VALUES][BYTE_VALUES];
+static unsigned short byte_sub_table[2][BYTE_VALUES][BYTE_VALUES];
+//[carry in][two digit sums modulo 16], the adjusted digits in the low byte and the carry out above them
+static unsigned short dadd_table[2][BYTE_VALUES];
+static bool tables_ready;
+
+/*
+ * @brief N and Z for a result, Z looks at all 16 bits even for byte operations
+ */
+static inline unsigned int nz_flags(unsigned int result, unsigned int msb_shift)
+{
+    return ((result >> msb_shift) & 1) << PSW_N_SHIFT | ((unsigned short)result == 0) << PSW_Z_SHIFT;
+}
+
+/*
+ * @brief C and V from the sign bits of the operands and result
+ * @param source the source, complemented for subtraction
+ */
+static inline unsigned int msb_cv_flags(unsigned int source, unsigned int dest, unsigned int result,
+                                        unsigned int msb_shift)
+{
+    unsigned int s = (source >> msb_shift) & 1;
+    unsigned int d = (dest >> msb_shift) & 1;
+    unsigned int r = (result >> msb_shift) & 1;
+    unsigned int carry = (s & d) | ((s | d) & ~r);
+    unsigned int overflow = (s & d & ~r) | (~s & ~d & r);
+    return (carry & 1) << PSW_C_SHIFT | (overflow & 1) << PSW_V_SHIFT;
+}
+
+/*
+ * @brief This function adjusts two digit sums, the carry in is added modulo 16 before
+ * the digit is compared with 9
+ * @return the two digits in the low byte and the carry out of the upper digit in bit 8
+ */
+static unsigned short dadd_digit_pair(unsigned int sums, unsigned int carry)
+{
+    unsigned int pair = 0;
+    unsigned int digit;
+    for (int shift = 0; shift < 8; shift += 4)
+    {
+        digit = ((sums >> shift) + carry) & 0x0F;
+        carry = digit > BCD_LIMIT;
+        pair |= (carry ? digit - BCD_ADJUST : digit) << shift;
+    }
+    return pair | carry << 8;
+}
+
+/*
+ * @brief This function fills the byte ADD and SUB tables from the reference semantics, later calls do nothing
+ */
+void init_alu_tables(void)
+{
+    unsigned short result;
+    if (tables_ready)
+    {
+        return;
+    }
+    for (unsigned int carry = 0; carry < 2; ++carry)
+    {
+        for (unsigned int dest = 0; dest < BYTE_VALUES; ++dest)
+        {
+            for (unsigned int source = 0; source < BYTE_VALUES; ++source)
+            {
+                result = dest + source + carry;
+                byte_add_table[carry][dest][source] = (result & 0xFF) |
+                        (nz_flags(result, BYTE_SHIFT) | msb_cv_flags(source, dest, result, BYTE_SHIFT)) << 8;
+                //dest + ~source + 1 + carry
+                result = dest - source + carry;
+                byte_sub_table[carry][dest][source] = (result & 0xFF) |
+                        (nz_flags(result, BYTE_SHIFT) | msb_cv_flags(~source, dest, result, BYTE_SHIFT)) << 8;
+            }
+        }
+        for (unsigned int sums = 0; sums < BYTE_VALUES; ++sums)
+        {
+            dadd_table[carry][sums] = dadd_digit_pair(sums, carry);
+        }
+    }
+    tables_ready = true;
+}
+
+/* ---- byte arithmetic, dest and source are below 256 ---- */
+static unsigned int add_byte(unsigned short dest, unsigned short source, unsigned char carry)
+{
+    return TABLE_OUT(byte_add_table[0][dest][source]);
+}
+
+static unsigned int addc_byte(unsigned short dest, unsigned short source, unsigned char carry)
+{
+    return TABLE_OUT(byte_add_table[carry][dest][source]);
+}
+
+static unsigned int sub_byte(unsigned short dest, unsigned short source, unsigned char carry)
+{
+    return TABLE_OUT(byte_sub_table[0][dest][source]);
+}
+
+static unsigned int subc_byte(unsigned short dest, unsigned short source, unsigned char carry)
+{
+    return TABLE_OUT(byte_sub_table[carry][dest][source]);
+}
+
+/* ---- word arithmetic ---- */
+static unsigned int add_word(unsigned short dest, unsigned short source, unsigned char carry)
+{
+    unsigned short result;
+    short signed_result;
+    unsigned int carry_out = __builtin_add_overflow(dest, source, &result);
+    unsigned int overflow = __builtin_add_overflow((short)dest, (short)source, &signed_result);
+    return ALU_OUT(result, nz_flags(result, WORD_SHIFT) | carry_out << PSW_C_SHIFT | overflow << PSW_V_SHIFT);
+}
+
+static unsigned int addc_word(unsigned short dest, unsigned short source, unsigned char carry)
+{
+    unsigned short partial;
+    unsigned short result;
+    short signed_partial;
+    short signed_result;
+    //a carry in of one can only carry or overflow once, in the first add or the second
+    unsigned int carry_out = __builtin_add_overflow(dest, source, &partial) |
+                             __builtin_add_overflow(partial, carry, &result);
+    unsigned int overflow = __builtin_add_overflow((short)dest, (short)source, &signed_partial) ^
+                            __builtin_add_overflow(signed_partial, (short)carry, &signed_result);
+    return ALU_OUT(result, nz_flags(result, WORD_SHIFT) | carry_out << PSW_C_SHIFT | overflow << PSW_V_SHIFT);
+}
+
+static unsigned int sub_word(unsigned short dest, unsigned short source, unsigned char carry)
+{
+    unsigned short result;
+    short signed_result;
+    //C is set when there is no borrow, as dest + ~source + 1 carries out
+    unsigned int carry_out = !__builtin_sub_overflow(dest, source, &result);
+    unsigned int overflow = __builtin_sub_overflow((short)dest, (short)source, &signed_result);
+    return ALU_OUT(result, nz_flags(result, WORD_SHIFT) | carry_out << PSW_C_SHIFT | overflow << PSW_V_SHIFT);
+}
+
+static unsigned int subc_word(unsigned short dest, unsigned short source, unsigned char carry)
+{
+    unsigned short result = dest - source + carry;
+    return ALU_OUT(result, nz_flags(result, WORD_SHIFT) | msb_cv_flags(~source, dest, result, WORD_SHIFT));
+}
+
+/* ---- logic, only N and Z change ---- */
+#define LOGIC_KERNELS(width, msb_shift) \
+static unsigned int xor_##width(unsigned short dest, unsigned short source, unsigned char carry) \
+{ \
+    return ALU_OUT(dest ^ source, nz_flags(dest ^ source, msb_shift)); \
+} \
+static unsigned int and_##width(unsigned short dest, unsigned short source, unsigned char carry) \
+{ \
+    return ALU_OUT(dest & source, nz_flags(dest & source, msb_shift)); \
+} \
+static unsigned int or_##width(unsigned short dest, unsigned short source, unsigned char carry) \
+{ \
+    return ALU_OUT(dest | source, nz_flags(dest | source, msb_shift)); \
+} \
+static unsigned int bit_##width(unsigned short dest, unsigned short source, unsigned char carry) \
+{ \
+    return ALU_OUT(dest & BIT_MASK(source), nz_flags(dest & BIT_MASK(source), msb_shift)); \
+} \
+static unsigned int bic_##width(unsigned short dest, unsigned short source, unsigned char carry) \
+{ \
+    return ALU_OUT(dest & ~BIT_MASK(source), nz_flags(dest & ~BIT_MASK(source), msb_shift)); \
+} \
+static unsigned int bis_##width(unsigned short dest, unsigned short source, unsigned char carry) \
+{ \
+    return ALU_OUT(dest | BIT_MASK(source), nz_flags(dest | BIT_MASK(source), msb_shift)); \
+}
+LOGIC_KERNELS(word, WORD_SHIFT)
+LOGIC_KERNELS(byte, BYTE_SHIFT)
+
+/*
+ * @brief kernels by [word_or_byte][opcode - add], DADD reads whole registers in both widths so it is called
+ * through alu_dadd instead, CMP and BIT use the SUB and BIT results without writing them back
+ */
+const AluKernel alu_kernels[2][ALU_OPCODES] = {
+        {add_word, addc_word, sub_word, subc_word, NULL, sub_word, xor_word, and_word, or_word, bit_word, bic_word,
+         bis_word},
+        {add_byte, addc_byte, sub_byte, subc_byte, NULL, sub_byte, xor_byte, and_byte, or_byte, bit_byte, bic_byte,
+         bis_byte}
+};
+
+//flags each opcode writes, indexed by opcode - add
+const unsigned char alu_flag_masks[ALU_OPCODES] = {
+        PSW_NZCV, PSW_NZCV, PSW_NZCV, PSW_NZCV, PSW_C | PSW_Z, PSW_NZCV, PSW_N | PSW_Z, PSW_N | PSW_Z, PSW_N | PSW_Z,
+        PSW_N | PSW_Z, PSW_N | PSW_Z, PSW_N | PSW_Z
+};
+
+/*
+ * @brief This function adds two packed BCD values, the digit sums are formed for all four digits at once and the
+ * carries between digits are then resolved a byte (two digits) at a time through dadd_table
+ * @param wb WORD adds four digits and sets or clears C from the top digit, BYTE adds two digits, clears the upper
+ * byte, and only sets C
+ * @return the result and the C and Z flags packed by ALU_OUT
+ */
+unsigned int alu_dadd(unsigned short dest, unsigned short source, unsigned char wb, unsigned char carry)
+{
+    unsigned int sums;
+    unsigned int low;
+    unsigned int high;
+    unsigned short result;
+    unsigned int carry_flag;
+
+    //16 and 32 from the constant table are taken as the BCD digits 16 and 32
+    source += (source == 16) * 0x06 + (source == 32) * 0x12;
+    //every digit is added modulo 16, masking alternate digits stops them carrying into their neighbours
+    sums = (((dest & 0x0F0F) + (source & 0x0F0F)) & 0x0F0F) | (((dest & 0xF0F0) + (source & 0xF0F0)) & 0xF0F0);
+    low = dadd_table[0][sums & 0xFF];
+    if (wb == WORD)
+    {
+        high = dadd_table[low >> 8][sums >> 8];
+        result = (low & 0xFF) | (high & 0xFF) << 8;
+        carry_flag = high >> 8;
+    }
+    else
+    {
+        result = low & 0xFF;
+        carry_flag = carry | low >> 8;
+    }
+    return ALU_OUT(result, carry_flag << PSW_C_SHIFT | (result == 0) << PSW_Z_SHIFT);
+}
@@ -0,0 +1,255 @@
+/*
+ * File Name: background.c
+ * Date October 19 2026
+ * Module Info: This module runs the emulator on its own thread while the front end stays responsive. The front end
+ * sends pause, resume, breakpoint and quit commands through a single producer single consumer ring that the
+ * emulator thread drains between batches of BACKGROUND_BATCH_CLOCKS clocks, neither side ever takes a lock.
+ *
+ * After every batch and every stop the emulator thread publishes a snapshot of the registers, PSW and clock under a
+ * sequence counter, odd while it is being written. A reader copies the snapshot and retries if the counter changed
+ * or was odd, so it always sees one consistent state without ever making the emulator wait.
+ */
+#include "emulation.h"
+#include <time.h>
+
+#define BACKGROUND_QUEUE_MASK (BACKGROUND_QUEUE_SIZE - 1)
+#define BACKGROUND_IDLE_NS 1000000 //1 ms between looks at the queue while paused
+#define MAX_CONSOLE_LINE 32
+
+/*
+ * @brief front end side of the queue
+ * @return false if the queue is full
+ */
+bool send_background_command(BackgroundEmulation *background, BACKGROUND_COMMANDS type, unsigned short address)
+{
+    unsigned int tail = atomic_load_explicit(&background->command_tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&background->command_head, memory_order_acquire);
+    if (tail - head == BACKGROUND_QUEUE_SIZE)
+    {
+        return false;
+    }
+    background->commands[tail & BACKGROUND_QUEUE_MASK].type = type;
+    background->commands[tail & BACKGROUND_QUEUE_MASK].address = address;
+    atomic_store_explicit(&background->command_tail, tail + 1, memory_order_release);
+    return true;
+}
+
+/*
+ * @brief emulator thread side of the queue
+ * @return false if the queue is empty
+ */
+static bool receive_command(BackgroundEmulation *background, BackgroundCommand *command)
+{
+    unsigned int head = atomic_load_explicit(&background->command_head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&background->command_tail, memory_order_acquire);
+    if (head == tail)
+    {
+        return false;
+    }
+    *command = background->commands[head & BACKGROUND_QUEUE_MASK];
+    atomic_store_explicit(&background->command_head, head + 1, memory_order_release);
+    return true;
+}
+
+static void publish_snapshot(BackgroundEmulation *background, bool paused, bool ended, StopReason reason)
+{
+    Emulator *emulator = background->emulator;
+    EmulatorSnapshot *snapshot = &background->snapshot;
+    unsigned int sequence = atomic_load_explicit(&background->snapshot_sequence, memory_order_relaxed);
+    atomic_store_explicit(&background->snapshot_sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    for (int reg = 0; reg < REGFILE_SIZE; ++reg)
+    {
+        snapshot->registers[reg] = emulator->reg_file[REGISTER][reg].word;
+    }
+    snapshot->psw = emulator->psw.word;
+    snapshot->clock = emulator->clock;
+    snapshot->retired = emulator->stats.retired;
+    snapshot->breakpoint = emulator->breakpoint;
+    snapshot->reason = reason;
+    snapshot->paused = paused;
+    snapshot->ended = ended;
+    atomic_store_explicit(&background->snapshot_sequence, sequence + 2, memory_order_release);
+}
+
+/*
+ * @brief This function copies the last published snapshot, retrying while the emulator thread is writing it
+ */
+void read_snapshot(BackgroundEmulation *background, EmulatorSnapshot *out)
+{
+    unsigned int before;
+    unsigned int after;
+    do
+    {
+        before = atomic_load_explicit(&background->snapshot_sequence, memory_order_acquire);
+        memcpy(out, &background->snapshot, sizeof(EmulatorSnapshot));
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&background->snapshot_sequence, memory_order_relaxed);
+    } while (before != after || (before & 1));
+}
+
+/*
+ * @brief This function is the emulator thread, it runs batches while resumed and idles while paused
+ */
+static void *background_thread(void *argument)
+{
+    BackgroundEmulation *background = argument;
+    Emulator *emulator = background->emulator;
+    struct timespec idle = {0, BACKGROUND_IDLE_NS};
+    BackgroundCommand command;
+    StopReason reason = STOP_CLOCK_BUDGET;
+    bool paused = false;
+    bool ended = false;
+
+    publish_snapshot(background, paused, ended, reason);
+    while (true)
+    {
+        while (receive_command(background, &command))
+        {
+            switch (command.type)
+            {
+                case BACKGROUND_PAUSE:
+                    paused = true;
+                    break;
+                case BACKGROUND_RESUME:
+                    //a run that is over stays over, starting it again would only repeat the stop
+                    paused = ended;
+                    break;
+                case BACKGROUND_SET_BREAKPOINT:
+                    set_breakpoint_address(emulator, command.address);
+                    break;
+                case BACKGROUND_QUIT:
+                    publish_snapshot(background, true, ended, reason);
+                    return NULL;
+            }
+            publish_snapshot(background, paused, ended, reason);
+        }
+        if (paused)
+        {
+            nanosleep(&idle, NULL);
+            continue;
+        }
+        reason = run_emulator(emulator, BACKGROUND_BATCH_CLOCKS);
+        if (reason != STOP_CLOCK_BUDGET)
+        {
+            paused = true;
+            ended = !emulator->has_started;
+            report_stop(emulator, reason);
+            fflush(stdout);
+        }
+        publish_snapshot(background, paused, ended, reason);
+    }
+}
+
+/*
+ * @brief This function starts the emulator thread, running the emulator quietly until it is paused or stopped
+ * @return false if the thread could not be created
+ */
+bool start_background(BackgroundEmulation *background, Emulator *emulator)
+{
+    memset(background, 0, sizeof(BackgroundEmulation));
+    background->emulator = emulator;
+    background->was_quiet = emulator->is_quiet;
+    //the trace would interleave with the front end
+    emulator->is_quiet = true;
+    atomic_init(&background->command_head, 0);
+    atomic_init(&background->command_tail, 0);
+    atomic_init(&background->snapshot_sequence, 0);
+    if (pthread_create(&background->thread, NULL, background_thread, background) != 0)
+    {
+        emulator->is_quiet = background->was_quiet;
+        return false;
+    }
+    return true;
+}
+
+/*
+ * @brief This function stops the emulator thread between batches and waits for it, the run can be resumed later
+ */
+void stop_background(BackgroundEmulation *background)
+{
+    struct timespec idle = {0, BACKGROUND_IDLE_NS};
+    while (!send_background_command(background, BACKGROUND_QUIT, 0))
+    {
+        nanosleep(&idle, NULL);
+    }
+    pthread_join(background->thread, NULL);
+    background->emulator->is_quiet = background->was_quiet;
+}
+
+static void print_snapshot(const EmulatorSnapshot *snapshot)
+{
+    for (int reg = 0; reg < REGFILE_SIZE; ++reg)
+    {
+        printf("R%d = %04X%s", reg, snapshot->registers[reg], reg % 4 == 3 ? "\n" : "  ");
+    }
+    printf("PSW = %04X  CLOCK: %lu  Retired: %lu  %s\n", snapshot->psw, snapshot->clock, snapshot->retired,
+           snapshot->ended ? "[ended]" : snapshot->paused ? "[paused]" : "[running]");
+}
+
+/*
+ * @brief This function runs the loaded program on the emulator thread and takes commands while it runs
+ */
+void background_console(Emulator *emulator)
+{
+    BackgroundEmulation *background;
+    EmulatorSnapshot snapshot;
+    char line[MAX_CONSOLE_LINE];
+    unsigned int address;
+    bool queued = true;
+
+    if (!emulator->is_memset)
+    {
+        printf("No file loaded, cannot run emulator\n");
+        return;
+    }
+    background = malloc(sizeof(BackgroundEmulation));
+    if (background == NULL || !start_background(background, emulator))
+    {
+        printf("Could not start the emulator thread\n");
+        free(background);
+        return;
+    }
+    printf("Running in the background: P pause, C continue, R registers, B <hex> breakpoint, Q back to the menu\n");
+    while (fgets(line, sizeof(line), stdin) != NULL)
+    {
+        switch (tolower(line[0]))
+        {
+            case 'p':
+                queued = send_background_command(background, BACKGROUND_PAUSE, 0);
+                break;
+            case 'c':
+                queued = send_background_command(background, BACKGROUND_RESUME, 0);
+                break;
+            case 'r':
+                read_snapshot(background, &snapshot);
+                print_snapshot(&snapshot);
+                break;
+            case 'b':
+                if (sscanf(line + 1, "%x", &address) != 1)
+                {
+                    printf("Enter the breakpoint after B\n");
+                    break;
+                }
+                queued = send_background_command(background, BACKGROUND_SET_BREAKPOINT, (unsigned short)address);
+                break;
+            case 'q':
+                stop_background(background);
+                read_snapshot(background, &snapshot);
+                print_snapshot(&snapshot);
+                free(background);
+                //the menu clears the rest of the line after every command, this line has already been read
+                ungetc('\n', stdin);
+                return;
+            default:
+                break;
+        }
+        if (!queued)
+        {
+            printf("Command queue full, try again\n");
+            queued = true;
+        }
+    }
+    stop_background(background);
+    free(background);
+}
@@ -0,0 +1,663 @@
+/*
+ * File Name: benchmark.c
+ * Date October 19 2026
+ * Module Info: This module is the entry point of the benchmark executable. It times the hot paths of the emulator
+ * (decoding, execute_arithmetic, the ALU kernels including DADD, the memory controller and the loader), compares
+ * a sweep run one emulator at a time against the lockstep engine, and runs the bundled .xme programs end to end to
+ * measure emulated MIPS. Results are written as JSON and can be compared against a saved
+ * baseline, the process exits with 1 if any benchmark slowed down by more than the threshold.
+ *
+ * Usage: XM23p_Benchmarks [-o results.json] [-b baseline.json] [-t threshold%] [-m min_seconds] [-f filter]
+ *                         [-x xme_directory] [-c clocks]
+ */
+#include "emulation.h"
+#include <time.h>
+#include <getopt.h>
+#include <dirent.h>
+#include <unistd.h>
+
+static Memory emulator_memory[2];
+Memory *xm23_memory = emulator_memory;
+FILE* input_file;
+
+#ifndef BENCHMARK_XME_DIR
+#define BENCHMARK_XME_DIR "."
+#endif
+#define MAX_BENCHMARKS 128
+#define MAX_NAME_LEN 64
+#define DEFAULT_MIN_TIME 0.2 //seconds each benchmark must run for
+#define DEFAULT_THRESHOLD 10.0 //percent slowdown reported as a regression
+#define DEFAULT_E2E_CLOCKS 4000000
+#define SYNTHETIC_RECORD_BYTES 16
+#define MAX_PATH_LEN 512
+#define WORD 0
+#define BYTE 1
+#define LOCKSTEP_INSTANCES 64
+#define LOCKSTEP_MANY_INSTANCES 100000 //6 GB as whole D-memories, a few pages each with copy on write
+#define LOCKSTEP_ORIGIN 0x0100
+#define DIFF_SPARSE_CHANGES 64
+
+typedef struct benchmark_result
+{
+    char name[MAX_NAME_LEN];
+    double ns_per_op;
+    double mips; //only set for end to end runs
+}BenchmarkResult;
+
+typedef void (*benchmark_body)(Emulator *emulator, const void *context, unsigned long int iterations);
+
+static BenchmarkResult results[MAX_BENCHMARKS];
+static int result_count;
+static double min_time = DEFAULT_MIN_TIME;
+static const char *filter;
+static volatile unsigned long int sink; //keeps results of timed loops alive
+
+static double now_seconds(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec * 1e-9;
+}
+
+static Emulator *new_benchmark_emulator(void)
+{
+    Emulator *emulator = calloc(1, sizeof(Emulator));
+    init_emulator(emulator);
+    emulator->is_quiet = true;
+    return emulator;
+}
+
+static void free_benchmark_emulator(Emulator *emulator)
+{
+    free(emulator->branch_profile);
+    free(emulator);
+}
+
+static void record_result(const char *name, double ns_per_op, double mips)
+{
+    if (result_count == MAX_BENCHMARKS)
+    {
+        return;
+    }
+    snprintf(results[result_count].name, MAX_NAME_LEN, "%s", name);
+    results[result_count].ns_per_op = ns_per_op;
+    results[result_count].mips = mips;
+    result_count++;
+    fprintf(stderr, "%-32s %12.3f ns/op\n", name, ns_per_op);
+}
+
+/*
+ * @brief This function times a benchmark body, doubling the iteration count until one batch runs for min_time
+ */
+static void run_benchmark(const char *name, Emulator *emulator, benchmark_body body, const void *context)
+{
+    unsigned long int iterations = 1;
+    double elapsed;
+    double start;
+    if (filter != NULL && strstr(name, filter) == NULL)
+    {
+        return;
+    }
+    while (true)
+    {
+        start = now_seconds();
+        body(emulator, context, iterations);
+        elapsed = now_seconds() - start;
+        if (elapsed >= min_time)
+        {
+            break;
+        }
+        iterations *= 2;
+    }
+    record_result(name, elapsed * 1e9 / (double)iterations, 0.0);
+}
+
+/* ---- decoder ---- */
+typedef struct word_list
+{
+    const unsigned short *words;
+    int count;
+}WordList;
+
+static void bench_decode(Emulator *emulator, const void *context, unsigned long int iterations)
+{
+    const WordList *list = context;
+    int index = 0;
+    for (unsigned long int i = 0; i < iterations; ++i)
+    {
+        emulator->instruction_register = list->words[index];
+        decode_instruction(emulator);
+        index = (index + 1 == list->count) ? 0 : index + 1;
+    }
+    sink += emulator->opcode;
+}
+
+#define WORD_LIST(words) {(words), sizeof(words) / sizeof((words)[0])}
+static const unsigned short branch_words[] = {0x2001, 0x27FD, 0x2BFE, 0x2C10, 0x3003, 0x3420, 0x3BF0, 0x3FFF};
+static const unsigned short link_words[] = {0x0002, 0x1FFE, 0x0100, 0x1800};
+static const unsigned short arithmetic_words[] = {0x4001, 0x40C8, 0x4288, 0x4311, 0x4413, 0x4513, 0x4642, 0x4701,
+                                                  0x48DA, 0x4901, 0x4A88, 0x4BC9};
+static const unsigned short reg_manip_words[] = {0x4C2F, 0x4CA1, 0x4D01, 0x4D09, 0x4D19, 0x4D21};
+static const unsigned short cpu_words[] = {0x4DA2, 0x4DC2, 0x4DB1, 0x4DD1};
+static const unsigned short load_store_words[] = {0x580A, 0x588B, 0x5C08, 0x5B12, 0x5E90, 0x8081, 0xC081, 0xBF4A};
+static const unsigned short reg_init_words[] = {0x6828, 0x6001, 0x7009, 0x7809};
+
+/* ---- ALU ---- */
+static void bench_execute_arithmetic(Emulator *emulator, const void *context, unsigned long int iterations)
+{
+    for (unsigned long int i = 0; i < iterations; ++i)
+    {
+        execute_arithmetic(emulator);
+    }
+    sink += emulator->reg_file[REGISTER][1].word;
+}
+
+static void bench_execute_arithmetic_mix(Emulator *emulator, const void *context, unsigned long int iterations)
+{
+    OPCODES opcode = add;
+    for (unsigned long int i = 0; i < iterations; ++i)
+    {
+        //every arithmetic opcode except DADD, which is timed on its own
+        emulator->opcode = opcode;
+        execute_arithmetic(emulator);
+        opcode = (opcode == bis) ? add : (opcode == subc) ? cmp : opcode + 1;
+    }
+    sink += emulator->reg_file[REGISTER][1].word;
+}
+
+typedef struct
+{
+    unsigned char word_or_byte;
+    OPCODES opcode;
+} KernelSelect;
+
+static void bench_alu_kernel(Emulator *emulator, const void *context, unsigned long int iterations)
+{
+    const KernelSelect *select = context;
+    AluKernel kernel = alu_kernels[select->word_or_byte][select->opcode - add];
+    unsigned short mask = select->word_or_byte ? 0xFF : 0xFFFF;
+    unsigned int out = 0;
+    for (unsigned long int i = 0; i < iterations; ++i)
+    {
+        out ^= kernel((unsigned short)(i ^ 0x5A5A) & mask, (unsigned short)(i * 0x9E37) & mask, i & 1);
+    }
+    sink += out;
+}
+
+static void bench_alu_dadd(Emulator *emulator, const void *context, unsigned long int iterations)
+{
+    const KernelSelect *select = context;
+    unsigned int out = 0;
+    for (unsigned long int i = 0; i < iterations; ++i)
+    {
+        //keep the destination a valid BCD value, it would otherwise drift out of range
+        out ^= alu_dadd(0x1234 + (i & 0x5), 0x0567, select->word_or_byte, i & 1);
+    }
+    sink += out;
+}
+
+/* ---- memory controller ---- */
+static void bench_memory_controller(Emulator *emulator, const void *context, unsigned long int iterations)
+{
+    MEMORY_ACCESS_TYPES type = *(const MEMORY_ACCESS_TYPES *)context;
+    for (unsigned long int i = 0; i < iterations; ++i)
+    {
+        emulator->xCTRL = type;
+        emulator->i_control.IMAR = (unsigned short)(i << 1);
+        emulator->d_control.DMAR = (unsigned short)(i * 6);
+        emulator->d_control.DMBR = (unsigned short)i;
+        memory_controller(emulator);
+    }
+    sink += emulator->i_control.IMBR + emulator->d_control.DMBR;
+}
+
+/* ---- loader ---- */
+/*
+ * @brief This function writes one S-record with its length and checksum
+ */
+static void write_record(FILE *image, char type, unsigned short address, const unsigned char *data, int length)
+{
+    unsigned char sum = length + 3 + (address >> 8) + (address & 0xFF);
+    fprintf(image, "S%c%02X%04X", type, length + 3, address);
+    for (int i = 0; i < length; ++i)
+    {
+        sum += data[i];
+        fprintf(image, "%02X", data[i]);
+    }
+    fprintf(image, "%02X\n", (unsigned char)~sum);
+}
+
+/*
+ * @brief This function writes an S-record image that fills the whole of I-memory
+ * @return false if the file could not be written
+ */
+static bool write_synthetic_image(const char *path)
+{
+    FILE *image = fopen(path, "w");
+    unsigned char data[SYNTHETIC_RECORD_BYTES];
+    if (image == NULL)
+    {
+        return false;
+    }
+    write_record(image, '0', 0, (const unsigned char *)"synthetic", 9);
+    for (unsigned int address = 0; address < (BYTE_MEMORY_SIZE); address += SYNTHETIC_RECORD_BYTES)
+    {
+        for (int i = 0; i < SYNTHETIC_RECORD_BYTES; ++i)
+        {
+            data[i] = (unsigned char)((address + i) * 37);
+        }
+        write_record(image, '1', address, data, SYNTHETIC_RECORD_BYTES);
+    }
+    write_record(image, '9', 0, NULL, 0);
+    fclose(image);
+    return true;
+}
+
+static void bench_load(Emulator *emulator, const void *context, unsigned long int iterations)
+{
+    for (unsigned long int i = 0; i < iterations; ++i)
+    {
+        load(input_file, (char *)context, emulator);
+    }
+    sink += xm23_memory[I_MEMORY].word[1];
+}
+
+/* ---- memory diff ---- */
+static Memory diff_banks[3]; //before, an equal copy and a copy with DIFF_SPARSE_CHANGES scattered bytes changed
+
+static void bench_memory_diff(Emulator *emulator, const void *context, unsigned long int iterations)
+{
+    DiffRange ranges[DIFF_SPARSE_CHANGES];
+    for (unsigned long int i = 0; i < iterations; ++i)
+    {
+        sink += diff_memory(diff_banks[0].byte, ((const Memory *)context)->byte, BYTE_MEMORY_SIZE, ranges,
+                            DIFF_SPARSE_CHANGES);
+    }
+}
+
+/* ---- lockstep ---- */
+//hashes R0 into R1 and R2 for 255 iterations with a branch on the low bit of R1, so the instances diverge and
+//reconverge every iteration
+static const unsigned short lockstep_program[] = {
+        0x6FFB, //MOVLZ #FF,R3
+        0x6804, //MOVLZ #0,R4
+        0x4001, //loop: ADD R0,R1
+        0x460A, //XOR R1,R2
+        0x4981, //BIT #0,R1
+        0x2002, //BEQ skip
+        0x408A, //ADD #1,R2
+        0x4602, //XOR R0,R2
+        0x5C8C, //skip: ST R1,R4+
+        0x428B, //SUB #1,R3
+        0x27F7, //BNE loop
+        0x3FFF  //BRA $
+};
+
+typedef enum
+{
+    SCALAR_EMULATORS, //one emulator after another through the functional executor
+    LOCKSTEP_SCALAR_LANES,
+    LOCKSTEP_AVX2
+}LOCKSTEP_BENCHMARKS;
+
+static unsigned short lockstep_input(unsigned int instance)
+{
+    return (unsigned short)(instance * 0x9E37 + 1);
+}
+
+/*
+ * @brief This function runs LOCKSTEP_INSTANCES copies of the program one after another, the way a sweep is run
+ * without the lockstep engine
+ * @return instructions executed across all the instances
+ */
+static unsigned long int run_scalar_instances(Emulator *emulator)
+{
+    unsigned long int instructions = 0;
+    for (unsigned int instance = 0; instance < LOCKSTEP_INSTANCES; ++instance)
+    {
+        memset(emulator->reg_file[REGISTER], 0, sizeof(emulator->reg_file[REGISTER]));
+        emulator->reg_file[REGISTER][0].word = lockstep_input(instance);
+        emulator->reg_file[REGISTER][PROG_COUNTER].word = LOCKSTEP_ORIGIN;
+        emulator->psw.word = 0;
+        emulator->xCTRL = NO_ACCESS;
+        emulator->hazard_control.d_bubble = true;
+        emulator->hazard_control.e_bubble = true;
+        while (true)
+        {
+            if (functional_step(emulator))
+            {
+                instructions++;
+                if (emulator->opcode <= bra && emulator->hazard_control.d_bubble &&
+                    emulator->reg_file[REGISTER][PROG_COUNTER].word == emulator->execute_address)
+                {
+                    break;
+                }
+            }
+        }
+    }
+    return instructions;
+}
+
+/*
+ * @brief This function times the instances run one after another and in lockstep, recording the time per
+ * instance instruction and the aggregate MIPS, group setup is left out of the timing
+ */
+static void run_lockstep_benchmark(const char *name, LOCKSTEP_BENCHMARKS mode, unsigned int instances)
+{
+    Emulator *emulator;
+    LockstepGroup *group;
+    unsigned long int instructions = 0;
+    double elapsed = 0;
+    double start;
+    if (filter != NULL && strstr(name, filter) == NULL)
+    {
+        return;
+    }
+    memset(xm23_memory, 0, sizeof(Memory) * 2);
+    memcpy(&xm23_memory[I_MEMORY].word[LOCKSTEP_ORIGIN >> 1], lockstep_program, sizeof(lockstep_program));
+    emulator = new_benchmark_emulator();
+    while (elapsed < min_time)
+    {
+        if (mode == SCALAR_EMULATORS)
+        {
+            start = now_seconds();
+            instructions += run_scalar_instances(emulator);
+            elapsed += now_seconds() - start;
+            continue;
+        }
+        group = create_lockstep_group(instances, LOCKSTEP_ORIGIN);
+        if (group == NULL)
+        {
+            break;
+        }
+        group->use_avx2 = group->use_avx2 && mode == LOCKSTEP_AVX2;
+        for (unsigned int lane = 0; lane < instances; ++lane)
+        {
+            group->reg_file[0][lane] = lockstep_input(lane);
+        }
+        start = now_seconds();
+        run_lockstep(group);
+        elapsed += now_seconds() - start;
+        for (unsigned int lane = 0; lane < instances; ++lane)
+        {
+            instructions += group->instructions[lane];
+        }
+        free_lockstep_group(group);
+    }
+    free_benchmark_emulator(emulator);
+    if (instructions)
+    {
+        record_result(name, elapsed * 1e9 / (double)instructions, (double)instructions / elapsed / 1e6);
+    }
+}
+
+/* ---- end to end ---- */
+static Memory loaded_memory[2]; //memory as the program was loaded, put back when a run halts
+
+/*
+ * @brief This function runs an .xme program quietly for a fixed number of clocks through run_emulator, with every
+ * check the run loop makes each clock, and records emulated MIPS. A program that halts before the clocks are up is
+ * run again from where it was loaded
+ */
+static void run_program(const char *path, const char *file_name, unsigned long int clocks)
+{
+    char name[MAX_NAME_LEN];
+    Emulator *emulator;
+    Emulator *loaded = malloc(sizeof(Emulator));
+    unsigned long int run_clocks = 0;
+    unsigned long int retired = 0;
+    StopReason reason;
+    double start;
+    double elapsed = 0.0;
+    snprintf(name, MAX_NAME_LEN, "e2e/%s", file_name);
+    if (loaded == NULL || (filter != NULL && strstr(name, filter) == NULL))
+    {
+        free(loaded);
+        return;
+    }
+    memset(xm23_memory, 0, sizeof(Memory) * 2);
+    emulator = new_benchmark_emulator();
+    load(input_file, (char *)path, emulator);
+    emulator->has_started = true;
+    memcpy(loaded_memory, xm23_memory, sizeof(loaded_memory));
+    memcpy(loaded, emulator, sizeof(Emulator));
+    while (true)
+    {
+        start = now_seconds();
+        reason = run_emulator(emulator, clocks - run_clocks);
+        elapsed += now_seconds() - start;
+        run_clocks += emulator->clock;
+        if (reason != STOP_HALT || run_clocks >= clocks)
+        {
+            break;
+        }
+        retired += emulator->stats.retired;
+        memcpy(emulator, loaded, sizeof(Emulator));
+        memcpy(xm23_memory, loaded_memory, sizeof(loaded_memory));
+    }
+    retired += emulator->stats.retired;
+    record_result(name, retired ? elapsed * 1e9 / (double)retired : 0.0, (double)retired / elapsed / 1e6);
+    free_benchmark_emulator(emulator);
+    free(loaded);
+}
+
+static int compare_names(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/*
+ * @brief This function runs every .xme program in a directory in name order
+ */
+static void run_programs(const char *directory, unsigned long int clocks)
+{
+    char *names[MAX_BENCHMARKS];
+    int name_count = 0;
+    char path[MAX_PATH_LEN];
+    struct dirent *entry;
+    DIR *dir = opendir(directory);
+    size_t length;
+    if (dir == NULL)
+    {
+        fprintf(stderr, "Could not open .xme directory %s, skipping end to end runs\n", directory);
+        return;
+    }
+    while ((entry = readdir(dir)) != NULL && name_count < MAX_BENCHMARKS)
+    {
+        length = strlen(entry->d_name);
+        if (length > 4 && strcmp(entry->d_name + length - 4, ".xme") == 0)
+        {
+            names[name_count++] = strdup(entry->d_name);
+        }
+    }
+    closedir(dir);
+    qsort(names, name_count, sizeof(char *), compare_names);
+    for (int i = 0; i < name_count; ++i)
+    {
+        snprintf(path, sizeof(path), "%s/%s", directory, names[i]);
+        run_program(path, names[i], clocks);
+        free(names[i]);
+    }
+}
+
+/* ---- reporting ---- */
+static void write_results_json(FILE *out)
+{
+    fprintf(out, "{\"benchmarks\": [\n");
+    for (int i = 0; i < result_count; ++i)
+    {
+        fprintf(out, "{\"name\": \"%s\", \"ns_per_op\": %.4f, \"mips\": %.4f}%s\n", results[i].name,
+                results[i].ns_per_op, results[i].mips, i + 1 < result_count ? "," : "");
+    }
+    fprintf(out, "]}\n");
+}
+
+/*
+ * @brief This function compares the results with a baseline written by an earlier run
+ * @return the number of benchmarks that slowed down by more than threshold percent
+ */
+static int compare_with_baseline(const char *baseline_path, double threshold)
+{
+    char line[256];
+    char name[MAX_NAME_LEN];
+    double baseline_ns;
+    double change;
+    int regressions = 0;
+    char *field;
+    FILE *baseline = fopen(baseline_path, "r");
+    if (baseline == NULL)
+    {
+        fprintf(stderr, "Could not open baseline %s\n", baseline_path);
+        return 0;
+    }
+    fprintf(stderr, "\n%-32s %12s %12s %9s\n", "BENCHMARK", "BASELINE", "CURRENT", "CHANGE");
+    //the results file has one benchmark per line, which is all this needs to parse
+    while (fgets(line, sizeof(line), baseline))
+    {
+        field = strstr(line, "\"name\": \"");
+        if (field == NULL || sscanf(field, "\"name\": \"%63[^\"]\"", name) != 1)
+        {
+            continue;
+        }
+        field = strstr(line, "\"ns_per_op\": ");
+        if (field == NULL || sscanf(field, "\"ns_per_op\": %lf", &baseline_ns) != 1 || baseline_ns <= 0)
+        {
+            continue;
+        }
+        for (int i = 0; i < result_count; ++i)
+        {
+            if (strcmp(results[i].name, name) == 0)
+            {
+                change = 100.0 * (results[i].ns_per_op - baseline_ns) / baseline_ns;
+                fprintf(stderr, "%-32s %12.3f %12.3f %+8.1f%%%s\n", name, baseline_ns, results[i].ns_per_op, change,
+                        change > threshold ? "  REGRESSION" : "");
+                regressions += change > threshold;
+                break;
+            }
+        }
+    }
+    fclose(baseline);
+    return regressions;
+}
+
+int main(int argc, char *argv[])
+{
+    static const MEMORY_ACCESS_TYPES memory_types[] = {I_MEMORY, D_READ, D_READ_B, D_WRITE, D_WRITE_B};
+    static const char *memory_names[] = {"memory/i_fetch", "memory/d_read", "memory/d_read_b", "memory/d_write",
+                                         "memory/d_write_b"};
+    static const struct { const char *name; unsigned short instruction; } arithmetic_variants[] = {
+            {"alu/add_word_reg", 0x4001}, {"alu/add_word_const", 0x4089},
+            {"alu/add_byte_reg", 0x4041}, {"alu/add_byte_const", 0x40C9}};
+    static const KernelSelect kernel_selects[] = {{WORD, add}, {BYTE, add}, {WORD, subc}, {BYTE, subc}, {WORD, and},
+                                                  {BYTE, bis}, {WORD, dadd}, {BYTE, dadd}};
+    static const char *kernel_names[] = {"alu_kernel/add_word", "alu_kernel/add_byte", "alu_kernel/subc_word",
+                                         "alu_kernel/subc_byte", "alu_kernel/and_word", "alu_kernel/bis_byte",
+                                         "alu_kernel/dadd_word", "alu_kernel/dadd_byte"};
+    const WordList decode_lists[] = {WORD_LIST(branch_words), WORD_LIST(link_words), WORD_LIST(arithmetic_words),
+                                     WORD_LIST(reg_manip_words), WORD_LIST(cpu_words), WORD_LIST(load_store_words),
+                                     WORD_LIST(reg_init_words)};
+    static const char *decode_names[] = {"decode/branch", "decode/bl", "decode/arithmetic", "decode/reg_manip",
+                                         "decode/cpu", "decode/load_store", "decode/reg_init"};
+    const char *output_path = NULL;
+    const char *baseline_path = NULL;
+    const char *xme_directory = BENCHMARK_XME_DIR;
+    double threshold = DEFAULT_THRESHOLD;
+    unsigned long int clocks = DEFAULT_E2E_CLOCKS;
+    char image_path[] = "/tmp/xm23_benchXXXXXX";
+    int image_fd;
+    int option;
+    int regressions = 0;
+    FILE *out = stdout;
+    Emulator *emulator;
+
+    while ((option = getopt(argc, argv, "o:b:t:m:f:x:c:")) != -1)
+    {
+        switch (option)
+        {
+            case 'o': output_path = optarg; break;
+            case 'b': baseline_path = optarg; break;
+            case 't': threshold = strtod(optarg, NULL); break;
+            case 'm': min_time = strtod(optarg, NULL); break;
+            case 'f': filter = optarg; break;
+            case 'x': xme_directory = optarg; break;
+            case 'c': clocks = strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "Usage: %s [-o results.json] [-b baseline.json] [-t threshold%%] [-m min_seconds] "
+                                "[-f filter] [-x xme_directory] [-c clocks]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    emulator = new_benchmark_emulator();
+    for (int i = 0; i < sizeof(decode_lists) / sizeof(decode_lists[0]); ++i)
+    {
+        run_benchmark(decode_names[i], emulator, bench_decode, &decode_lists[i]);
+    }
+    for (int i = 0; i < sizeof(arithmetic_variants) / sizeof(arithmetic_variants[0]); ++i)
+    {
+        emulator->instruction_register = arithmetic_variants[i].instruction;
+        decode_instruction(emulator);
+        run_benchmark(arithmetic_variants[i].name, emulator, bench_execute_arithmetic, NULL);
+    }
+    run_benchmark("alu/mix", emulator, bench_execute_arithmetic_mix, NULL);
+    for (int i = 0; i < sizeof(kernel_selects) / sizeof(kernel_selects[0]); ++i)
+    {
+        run_benchmark(kernel_names[i], emulator, kernel_selects[i].opcode == dadd ? bench_alu_dadd : bench_alu_kernel,
+                      &kernel_selects[i]);
+    }
+    for (int i = 0; i < sizeof(memory_types) / sizeof(memory_types[0]); ++i)
+    {
+        run_benchmark(memory_names[i], emulator, bench_memory_controller, &memory_types[i]);
+    }
+    add_cache(emulator, I_MEMORY, (CacheConfig){1024, 2, 16, CACHE_WRITE_BACK, 10});
+    add_cache(emulator, D_MEMORY, (CacheConfig){1024, 4, 16, CACHE_WRITE_BACK, 10});
+    run_benchmark("memory/i_fetch_cached", emulator, bench_memory_controller, &memory_types[0]);
+    run_benchmark("memory/d_write_cached", emulator, bench_memory_controller, &memory_types[3]);
+    remove_cache(emulator, I_MEMORY);
+    remove_cache(emulator, D_MEMORY);
+    image_fd = mkstemp(image_path);
+    if (image_fd != -1)
+    {
+        //write_synthetic_image reopens the path as a stream, the descriptor is only needed to create the file
+        close(image_fd);
+        if (write_synthetic_image(image_path))
+        {
+            run_benchmark("loader/full_imem_image", emulator, bench_load, image_path);
+        }
+        unlink(image_path);
+    }
+    for (int i = 0; i < BYTE_MEMORY_SIZE; ++i)
+    {
+        diff_banks[0].byte[i] = diff_banks[1].byte[i] = diff_banks[2].byte[i] = (unsigned char)(i * 7);
+    }
+    for (int i = 0; i < DIFF_SPARSE_CHANGES; ++i)
+    {
+        diff_banks[2].byte[i * ((BYTE_MEMORY_SIZE) / DIFF_SPARSE_CHANGES) + i] ^= 0xFF;
+    }
+    run_benchmark("memory_diff/64k_equal", emulator, bench_memory_diff, &diff_banks[1]);
+    run_benchmark("memory_diff/64k_sparse", emulator, bench_memory_diff, &diff_banks[2]);
+    free_benchmark_emulator(emulator);
+
+    run_lockstep_benchmark("lockstep/scalar_emulators", SCALAR_EMULATORS, LOCKSTEP_INSTANCES);
+    run_lockstep_benchmark("lockstep/scalar_lanes", LOCKSTEP_SCALAR_LANES, LOCKSTEP_INSTANCES);
+    run_lockstep_benchmark("lockstep/avx2", LOCKSTEP_AVX2, LOCKSTEP_INSTANCES);
+    run_lockstep_benchmark("lockstep/avx2_100k", LOCKSTEP_AVX2, LOCKSTEP_MANY_INSTANCES);
+    run_programs(xme_directory, clocks);
+
+    if (output_path != NULL && (out = fopen(output_path, "w")) == NULL)
+    {
+        fprintf(stderr, "Could not open %s, writing results to stdout\n", output_path);
+        out = stdout;
+    }
+    write_results_json(out);
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+    if (baseline_path != NULL)
+    {
+        regressions = compare_with_baseline(baseline_path, threshold);
+        fprintf(stderr, "%d regression(s) over %.1f%%\n", regressions, threshold);
+    }
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,270 @@
+/*
+ * File Name: cache.c
+ * Date October 19 2026
+ * Module Info: This module simulates set associative caches in front of the Harvard memories. The memory controller
+ * passes every fetch to the I-cache model and every data read and write to the D-cache model, the emulator's own
+ * timing is unchanged so the report gives the hit rates and the stall cycles each configuration would have added.
+ *
+ * A way is one 16 bit entry holding the line number (address >> line shift) with valid and dirty flags in the top
+ * bits, so a set of ways is a few contiguous bytes and the tag array of a 1 KB 4 way cache fits in 128 bytes. Ways
+ * are kept in most recently used order, a hit on way 0 is one compare and the last way is the LRU victim.
+ *
+ * Write back caches allocate on a write miss and charge the miss penalty again for each dirty line they evict.
+ * Write through caches do not allocate on a write miss and send every write to memory through a write buffer, the
+ * writes are counted as memory traffic but do not stall.
+ */
+#include "emulation.h"
+
+#define CACHE_VALID 0x8000
+#define CACHE_DIRTY 0x4000
+#define MIN_CACHE_LINE 4 //keeps the line number below the flag bits
+#define MAX_CACHE_LINE 256
+#define MAX_CACHE_WAYS 16
+#define PERCENT(part, whole) ((whole) ? (100.0 * (double)(part) / (double)(whole)) : 0.0)
+
+static const char cache_names[CACHE_TYPES] = {'I', 'D'};
+
+static bool is_power_of_two(unsigned int value)
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+/*
+ * @brief This function replaces the I or D cache model with a new empty one
+ * @param mem_type I_MEMORY or D_MEMORY
+ * @return false if the configuration is invalid or the tags could not be allocated
+ */
+bool add_cache(Emulator *emulator, int mem_type, CacheConfig config)
+{
+    CacheModel *cache;
+    unsigned int sets;
+    if (!is_power_of_two(config.line_size) || config.line_size < MIN_CACHE_LINE || config.line_size > MAX_CACHE_LINE)
+    {
+        printf("Cache lines must be a power of two from %d to %d bytes\n", MIN_CACHE_LINE, MAX_CACHE_LINE);
+        return false;
+    }
+    if (config.ways == 0 || config.ways > MAX_CACHE_WAYS || config.size % (config.line_size * config.ways) != 0 ||
+        !is_power_of_two(sets = config.size / (config.line_size * config.ways)) || config.size > (BYTE_MEMORY_SIZE))
+    {
+        printf("Cache size must be a power of two number of sets of up to %d ways, at most %d bytes\n",
+               MAX_CACHE_WAYS, BYTE_MEMORY_SIZE);
+        return false;
+    }
+    cache = calloc(1, sizeof(CacheModel));
+    if (cache == NULL || (cache->ways = calloc(sets * config.ways, sizeof(unsigned short))) == NULL)
+    {
+        free(cache);
+        printf("Failed to allocate memory for the cache tags\n");
+        return false;
+    }
+    cache->config = config;
+    cache->set_mask = sets - 1;
+    cache->line_shift = (unsigned char)__builtin_ctz(config.line_size);
+    remove_cache(emulator, mem_type);
+    emulator->caches[mem_type] = cache;
+    return true;
+}
+
+void remove_cache(Emulator *emulator, int mem_type)
+{
+    if (emulator->caches[mem_type] != NULL)
+    {
+        free(emulator->caches[mem_type]->ways);
+        free(emulator->caches[mem_type]);
+        emulator->caches[mem_type] = NULL;
+    }
+}
+
+/*
+ * @brief This function looks an access up in the cache, filling and evicting on a miss
+ */
+void cache_access(CacheModel *cache, unsigned short address, bool is_write)
+{
+    unsigned short line = address >> cache->line_shift;
+    unsigned short *set = &cache->ways[(line & cache->set_mask) * cache->config.ways];
+    unsigned short entry;
+    int way = 0;
+    if ((set[0] & ~CACHE_DIRTY) == (line | CACHE_VALID) && !is_write)
+    {
+        //a read of the most recently used line, nothing moves
+        cache->reads++;
+        return;
+    }
+    while (way < cache->config.ways && (set[way] & ~CACHE_DIRTY) != (line | CACHE_VALID))
+    {
+        way++;
+    }
+    if (is_write)
+    {
+        cache->writes++;
+        if (cache->config.write_policy == CACHE_WRITE_THROUGH)
+        {
+            cache->memory_writes++;
+            if (way == cache->config.ways)
+            {
+                //no write allocate, the line is not brought in
+                cache->write_misses++;
+                return;
+            }
+        }
+    }
+    else
+    {
+        cache->reads++;
+    }
+    if (way < cache->config.ways)
+    {
+        entry = set[way];
+    }
+    else
+    {
+        way = cache->config.ways - 1;
+        if ((set[way] & (CACHE_VALID | CACHE_DIRTY)) == (CACHE_VALID | CACHE_DIRTY))
+        {
+            cache->writebacks++;
+            cache->stall_cycles += cache->config.miss_penalty;
+        }
+        is_write ? cache->write_misses++ : cache->read_misses++;
+        cache->stall_cycles += cache->config.miss_penalty;
+        entry = line | CACHE_VALID;
+    }
+    if (is_write && cache->config.write_policy == CACHE_WRITE_BACK)
+    {
+        entry |= CACHE_DIRTY;
+    }
+    //move the line to the front, the ways in front of it each age by one
+    for (; way > 0; --way)
+    {
+        set[way] = set[way - 1];
+    }
+    set[0] = entry;
+}
+
+static unsigned long int cache_misses(const CacheModel *cache)
+{
+    return cache->read_misses + cache->write_misses;
+}
+
+/*
+ * @brief This function prints the hit rates and stall cycles of the I and D caches
+ */
+void print_cache_report(Emulator *emulator)
+{
+    CacheModel *cache;
+    unsigned long int stalls = 0;
+    printf("== Caches ==\n");
+    printf("CACHE  SIZE   WAYS  LINE  POLICY  PENALTY  ACCESSES      MISSES        MISS%%   WRITEBACKS  "
+           "MEM WRITES  STALL CYCLES\n");
+    for (int i = 0; i < CACHE_TYPES; ++i)
+    {
+        cache = emulator->caches[i];
+        if (cache == NULL)
+        {
+            continue;
+        }
+        stalls += cache->stall_cycles;
+        printf("%c      %-6u %-5u %-5u %-7s %-8u %-13lu %-13lu %5.1f%%  %-11lu %-11lu %lu\n", cache_names[i],
+               cache->config.size, cache->config.ways, cache->config.line_size,
+               cache->config.write_policy == CACHE_WRITE_BACK ? "WB" : "WT", cache->config.miss_penalty,
+               cache->reads + cache->writes, cache_misses(cache),
+               PERCENT(cache_misses(cache), cache->reads + cache->writes), cache->writebacks, cache->memory_writes,
+               cache->stall_cycles);
+    }
+    printf("Clocks with cache stalls: %lu (+%.1f%%)\n", emulator->clock + stalls, PERCENT(stalls, emulator->clock));
+}
+
+/*
+ * @brief This function writes the caches as a JSON array
+ */
+void write_caches_json(Emulator *emulator, FILE *out)
+{
+    CacheModel *cache;
+    bool first = true;
+    fprintf(out, "[");
+    for (int i = 0; i < CACHE_TYPES; ++i)
+    {
+        cache = emulator->caches[i];
+        if (cache == NULL)
+        {
+            continue;
+        }
+        fprintf(out, "%s{\"cache\": \"%c\", \"size\": %u, \"ways\": %u, \"line_size\": %u, \"write_policy\": \"%s\", "
+                     "\"miss_penalty\": %u, \"reads\": %lu, \"writes\": %lu, \"read_misses\": %lu, "
+                     "\"write_misses\": %lu, \"writebacks\": %lu, \"memory_writes\": %lu, \"stall_cycles\": %lu}",
+                first ? "" : ", ", cache_names[i], cache->config.size, cache->config.ways, cache->config.line_size,
+                cache->config.write_policy == CACHE_WRITE_BACK ? "write_back" : "write_through",
+                cache->config.miss_penalty, cache->reads, cache->writes, cache->read_misses, cache->write_misses,
+                cache->writebacks, cache->memory_writes, cache->stall_cycles);
+        first = false;
+    }
+    fprintf(out, "]");
+}
+
+/*
+ * @brief This function reads a cache configuration written as size:ways:line:B|T:penalty, B for write back and T
+ * for write through
+ * @return false if the text is not a configuration
+ */
+bool parse_cache_config(const char *text, CacheConfig *config)
+{
+    unsigned int ways;
+    unsigned int line_size;
+    char policy;
+    int end = 0;
+    if (sscanf(text, "%u:%u:%u:%c:%u%n", &config->size, &ways, &line_size, &policy, &config->miss_penalty,
+               &end) != 5 || text[end] != '\0' || (toupper(policy) != 'B' && toupper(policy) != 'T') ||
+        ways > MAX_CACHE_WAYS || line_size > MAX_CACHE_LINE)
+    {
+        return false;
+    }
+    config->ways = (unsigned char)ways;
+    config->line_size = (unsigned short)line_size;
+    config->write_policy = toupper(policy) == 'B' ? CACHE_WRITE_BACK : CACHE_WRITE_THROUGH;
+    return true;
+}
+
+/*
+ * @brief This function adds or removes a cache and prints the report
+ */
+void cache_menu(Emulator *emulator)
+{
+    char command;
+    char mem_type;
+    char text[MAX_RECORD_LEN];
+    CacheConfig config;
+    printf("Enter A I|D size:ways:line:B|T:penalty to add a cache, O I|D to remove one, R for the report: ");
+    if (scanf(" %c", &command) != 1)
+    {
+        return;
+    }
+    switch (toupper(command))
+    {
+        case 'A':
+            if (scanf(" %c %70s", &mem_type, text) != 2 || (toupper(mem_type) != 'I' && toupper(mem_type) != 'D') ||
+                !parse_cache_config(text, &config))
+            {
+                printf("Enter the cache (I/D) and size:ways:line:B|T:penalty after A\n");
+                break;
+            }
+            if (add_cache(emulator, toupper(mem_type) == 'I' ? I_MEMORY : D_MEMORY, config))
+            {
+                printf("Simulating a %u byte %u way %c-cache\n", config.size, config.ways, toupper(mem_type));
+            }
+            break;
+        case 'O':
+            if (scanf(" %c", &mem_type) != 1 || (toupper(mem_type) != 'I' && toupper(mem_type) != 'D'))
+            {
+                printf("Enter the cache (I/D) after O\n");
+                break;
+            }
+            remove_cache(emulator, toupper(mem_type) == 'I' ? I_MEMORY : D_MEMORY);
+            printf("%c-cache removed\n", toupper(mem_type));
+            break;
+        case 'R':
+            print_cache_report(emulator);
+            break;
+        default:
+            printf("Invalid cache command\n");
+            break;
+    }
+}
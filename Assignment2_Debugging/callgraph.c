@@ -0,0 +1,411 @@
+/*
+ * File Name: callgraph.c
+ * Date October 19 2026
+ * Module Info: This module profiles the program by function. A shadow call stack is pushed when BL executes and
+ * popped when an instruction writes the PC with the return address of a frame on it, normally MOV LR,PC or a load
+ * of the saved LR into the PC. The clocks between calls and returns are charged to the function on top, in a
+ * calling context tree with one node per distinct call path.
+ *
+ * Returns are matched against every frame, not only the top, so a return that skips frames (a routine that
+ * discards its caller's frame) unwinds them, and a PC write that matches no frame is only a jump. Calls deeper
+ * than CALL_STACK_DEPTH or past MAX_CALL_NODES paths are charged to the deepest frame so recursion cannot exhaust
+ * the profile, the untracked calls are counted by return address so only a write to one of those ends them. The
+ * report gives inclusive and exclusive clocks per function, where recursion counts inclusive clocks once, and
+ * folded stacks ("outer;inner clocks" per line) for flame graph tools.
+ */
+#include "emulation.h"
+
+#define CALL_ROOT 0
+#define NO_NODE (-1)
+#define MAX_FRAME_NAME (MAX_SYMBOL_LEN + 8)
+#define MAX_FOLDED_PATH ((CALL_STACK_DEPTH + 1) * MAX_FRAME_NAME)
+
+typedef struct function_totals
+{
+    unsigned long int calls;
+    unsigned long int exclusive;
+    unsigned long int inclusive;
+    unsigned int active; //times the function is on the path being walked, inclusive clocks count only the outermost
+    unsigned short function;
+}FunctionTotals;
+
+/*
+ * @brief This function starts profiling from the current clock, the root of the tree is the code running now
+ * @return false if the profile could not be allocated
+ */
+bool enable_call_profile(Emulator *emulator)
+{
+    CallProfile *profile = emulator->call_profile;
+    if (profile == NULL)
+    {
+        profile = calloc(1, sizeof(CallProfile));
+        if (profile == NULL)
+        {
+            return false;
+        }
+        emulator->call_profile = profile;
+    }
+    memset(profile, 0, sizeof(CallProfile));
+    profile->nodes[CALL_ROOT].function = next_execute_address(emulator);
+    profile->nodes[CALL_ROOT].parent = NO_NODE;
+    profile->nodes[CALL_ROOT].first_child = NO_NODE;
+    profile->nodes[CALL_ROOT].next_sibling = NO_NODE;
+    profile->node_count = 1;
+    profile->last_clock = emulator->clock;
+    return true;
+}
+
+void disable_call_profile(Emulator *emulator)
+{
+    free(emulator->call_profile);
+    emulator->call_profile = NULL;
+}
+
+/*
+ * @brief This function charges the clocks since the last call or return to the function on top of the stack
+ */
+static void charge_clocks(CallProfile *profile, unsigned long int clock)
+{
+    int node = profile->depth ? profile->stack[profile->depth - 1].node : CALL_ROOT;
+    profile->nodes[node].self_clocks += clock - profile->last_clock;
+    profile->last_clock = clock;
+}
+
+/*
+ * @brief This function finds the callee under the caller's node, adding it the first time the path is seen
+ * @return the callee's node, or the caller's if the tree is full
+ */
+static int callee_node(CallProfile *profile, int caller, unsigned short function)
+{
+    CallNode *nodes = profile->nodes;
+    int previous = NO_NODE;
+    int node;
+    for (node = nodes[caller].first_child; node != NO_NODE; node = nodes[node].next_sibling)
+    {
+        if (nodes[node].function == function)
+        {
+            //move to the front, a loop calling one function finds it first every time
+            if (previous != NO_NODE)
+            {
+                nodes[previous].next_sibling = nodes[node].next_sibling;
+                nodes[node].next_sibling = nodes[caller].first_child;
+                nodes[caller].first_child = node;
+            }
+            return node;
+        }
+        previous = node;
+    }
+    if (profile->node_count == MAX_CALL_NODES)
+    {
+        profile->truncated_calls++;
+        return caller;
+    }
+    node = profile->node_count++;
+    nodes[node].function = function;
+    nodes[node].parent = caller;
+    nodes[node].first_child = NO_NODE;
+    nodes[node].next_sibling = nodes[caller].first_child;
+    nodes[caller].first_child = node;
+    return node;
+}
+
+/*
+ * @brief This function remembers where a call too deep to track will return, so only a PC write to that address
+ * counts as its return. Calls past MAX_UNTRACKED_RETURNS distinct addresses are dropped, their returns are jumps
+ */
+static void push_untracked(CallProfile *profile, unsigned short return_address)
+{
+    int entry = 0;
+    while (entry < profile->untracked_count && profile->untracked[entry].return_address != return_address)
+    {
+        entry++;
+    }
+    if (entry == MAX_UNTRACKED_RETURNS)
+    {
+        return;
+    }
+    if (entry == profile->untracked_count)
+    {
+        profile->untracked[entry].return_address = return_address;
+        profile->untracked[entry].count = 0;
+        profile->untracked_count++;
+    }
+    profile->untracked[entry].count++;
+    profile->untracked_depth++;
+}
+
+/*
+ * @brief This function takes back an untracked call returning to the target, freeing its entry once none are left
+ * @return false if no untracked call returns there
+ */
+static bool pop_untracked(CallProfile *profile, unsigned short target)
+{
+    for (int entry = 0; entry < profile->untracked_count; ++entry)
+    {
+        if (profile->untracked[entry].return_address == target)
+        {
+            if (--profile->untracked[entry].count == 0)
+            {
+                profile->untracked[entry] = profile->untracked[--profile->untracked_count];
+            }
+            profile->untracked_depth--;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void profile_call(CallProfile *profile, unsigned long int clock, unsigned short function,
+                         unsigned short return_address)
+{
+    int caller = profile->depth ? profile->stack[profile->depth - 1].node : CALL_ROOT;
+    int node;
+    charge_clocks(profile, clock);
+    if (profile->depth == CALL_STACK_DEPTH)
+    {
+        //too deep to track, the clocks stay with the deepest frame until its calls come back out
+        push_untracked(profile, return_address);
+        profile->truncated_calls++;
+        return;
+    }
+    node = callee_node(profile, caller, function);
+    profile->nodes[node].calls++;
+    profile->stack[profile->depth].node = node;
+    profile->stack[profile->depth].return_address = return_address;
+    profile->depth++;
+}
+
+static void profile_return(CallProfile *profile, unsigned long int clock, unsigned short target)
+{
+    int frame = profile->depth - 1;
+    if (profile->untracked_depth && pop_untracked(profile, target))
+    {
+        return;
+    }
+    while (frame >= 0 && profile->stack[frame].return_address != target)
+    {
+        frame--;
+    }
+    if (frame < 0)
+    {
+        //a jump through a register, not a return
+        return;
+    }
+    charge_clocks(profile, clock);
+    //calls past the tracked frames went with them
+    profile->unwound_frames += profile->depth - 1 - frame + profile->untracked_depth;
+    profile->untracked_depth = 0;
+    profile->untracked_count = 0;
+    profile->depth = frame;
+}
+
+/*
+ * @brief This function follows the instruction E0 or the functional executor has just executed, a BL pushes a frame
+ * and any other instruction that wrote the PC may be a return
+ */
+void profile_calls(Emulator *emulator, bool pc_written)
+{
+    CallProfile *profile = emulator->call_profile;
+    if (emulator->opcode == bl)
+    {
+        profile_call(profile, emulator->clock, emulator->execute_address + EXECUTE_PC_OFFSET + emulator->offset,
+                     emulator->reg_file[REGISTER][LINK_REG].word);
+    }
+    else if (pc_written && emulator->opcode > bra)
+    {
+        profile_return(profile, emulator->clock, emulator->reg_file[REGISTER][PROG_COUNTER].word);
+    }
+}
+
+/*
+ * @brief This function follows a load into the PC, which completes in E1
+ */
+void profile_load_return(Emulator *emulator)
+{
+    profile_return(emulator->call_profile, emulator->clock, emulator->d_control.DMBR);
+}
+
+static const char *frame_name(Emulator *emulator, unsigned short function)
+{
+    static char name[MAX_FRAME_NAME];
+    const Symbol *symbol = emulator->symbols != NULL ? find_symbol(emulator->symbols, function) : NULL;
+    if (symbol == NULL)
+    {
+        snprintf(name, sizeof(name), "%04X", function);
+    }
+    else if (symbol->address == function)
+    {
+        snprintf(name, sizeof(name), "%s", symbol->name);
+    }
+    else
+    {
+        snprintf(name, sizeof(name), "%s+%X", symbol->name, function - symbol->address);
+    }
+    return name;
+}
+
+/*
+ * @brief This function adds up a node's subtree and the per function totals beneath it
+ * @return the node's inclusive clocks
+ */
+static unsigned long int total_node(const CallProfile *profile, int node, FunctionTotals *totals)
+{
+    const CallNode *call = &profile->nodes[node];
+    FunctionTotals *function = &totals[call->function >> 1];
+    unsigned long int inclusive = call->self_clocks;
+    function->function = call->function;
+    function->calls += call->calls;
+    function->exclusive += call->self_clocks;
+    function->active++;
+    for (int child = call->first_child; child != NO_NODE; child = profile->nodes[child].next_sibling)
+    {
+        inclusive += total_node(profile, child, totals);
+    }
+    function->active--;
+    if (function->active == 0)
+    {
+        function->inclusive += inclusive;
+    }
+    return inclusive;
+}
+
+static int compare_inclusive(const void *a, const void *b)
+{
+    const FunctionTotals *left = a;
+    const FunctionTotals *right = b;
+    if (left->inclusive != right->inclusive)
+    {
+        return left->inclusive < right->inclusive ? 1 : -1;
+    }
+    return left->exclusive < right->exclusive ? 1 : left->exclusive > right->exclusive ? -1 : 0;
+}
+
+/*
+ * @brief This function prints the functions ranked by inclusive clocks
+ */
+void print_call_profile(Emulator *emulator)
+{
+    CallProfile *profile = emulator->call_profile;
+    FunctionTotals *totals = calloc(WORD_MEMORY_SIZE, sizeof(FunctionTotals));
+    unsigned long int total;
+    int functions = 0;
+    if (totals == NULL)
+    {
+        printf("Failed to allocate memory for the call profile\n");
+        return;
+    }
+    charge_clocks(profile, emulator->clock);
+    total = total_node(profile, CALL_ROOT, totals);
+    for (int i = 0; i < (WORD_MEMORY_SIZE); ++i)
+    {
+        if (totals[i].inclusive || totals[i].calls || (i == profile->nodes[CALL_ROOT].function >> 1))
+        {
+            totals[functions++] = totals[i];
+        }
+    }
+    qsort(totals, functions, sizeof(FunctionTotals), compare_inclusive);
+    printf("== Call Graph Profile (%d functions, %d call paths, %lu clocks) ==\n", functions, profile->node_count,
+           total);
+    printf("ADDR  CALLS       INCLUSIVE     INCL%%   EXCLUSIVE     EXCL%%   FUNCTION\n");
+    for (int i = 0; i < functions; ++i)
+    {
+        printf("%04X  %-10lu  %-12lu  %5.1f%%  %-12lu  %5.1f%%  %s\n", totals[i].function, totals[i].calls,
+               totals[i].inclusive, total ? 100.0 * totals[i].inclusive / total : 0.0, totals[i].exclusive,
+               total ? 100.0 * totals[i].exclusive / total : 0.0, frame_name(emulator, totals[i].function));
+    }
+    if (profile->truncated_calls || profile->unwound_frames)
+    {
+        printf("Calls charged to their caller: %lu, frames unwound without their own return: %lu\n",
+               profile->truncated_calls, profile->unwound_frames);
+    }
+    free(totals);
+}
+
+static void write_folded_node(Emulator *emulator, FILE *out, int node, char *path, size_t length)
+{
+    const CallNode *call = &emulator->call_profile->nodes[node];
+    size_t added = (size_t)snprintf(path + length, MAX_FOLDED_PATH - length, "%s%s", length ? ";" : "",
+                                    frame_name(emulator, call->function));
+    length = length + added < MAX_FOLDED_PATH ? length + added : MAX_FOLDED_PATH - 1;
+    if (call->self_clocks)
+    {
+        fprintf(out, "%s %lu\n", path, call->self_clocks);
+    }
+    for (int child = call->first_child; child != NO_NODE; child = emulator->call_profile->nodes[child].next_sibling)
+    {
+        write_folded_node(emulator, out, child, path, length);
+    }
+}
+
+/*
+ * @brief This function writes one line per call path with the clocks spent in its last function, the folded
+ * stack format flamegraph.pl and speedscope read
+ */
+void write_folded_stacks(Emulator *emulator, FILE *out)
+{
+    char *path = malloc(MAX_FOLDED_PATH);
+    if (path == NULL)
+    {
+        return;
+    }
+    charge_clocks(emulator->call_profile, emulator->clock);
+    path[0] = '\0';
+    write_folded_node(emulator, out, CALL_ROOT, path, 0);
+    free(path);
+}
+
+/*
+ * @brief This function turns call profiling on or off and prints or writes the profile
+ */
+void call_profile_menu(Emulator *emulator)
+{
+    char command;
+    char file_name[MAX_RECORD_LEN];
+    FILE *out;
+    printf("Enter E to start profiling, O to stop, R for the report, F <file> to write folded stacks: ");
+    if (scanf(" %c", &command) != 1)
+    {
+        return;
+    }
+    command = (char)toupper(command);
+    if (command == 'E')
+    {
+        printf(enable_call_profile(emulator) ? "Profiling calls\n" : "Could not allocate the call profile\n");
+        return;
+    }
+    if (command == 'O')
+    {
+        disable_call_profile(emulator);
+        printf("Call profiling off\n");
+        return;
+    }
+    if (command != 'R' && command != 'F')
+    {
+        printf("Invalid call profile command\n");
+        return;
+    }
+    if (command == 'F' && scanf("%70s", file_name) != 1)
+    {
+        printf("Enter the file after F\n");
+        return;
+    }
+    if (emulator->call_profile == NULL)
+    {
+        printf("Calls are not being profiled, enter E first\n");
+        return;
+    }
+    if (command == 'R')
+    {
+        print_call_profile(emulator);
+        return;
+    }
+    out = fopen(file_name, "w");
+    if (out == NULL)
+    {
+        printf("Could not open %s\n", file_name);
+        return;
+    }
+    write_folded_stacks(emulator, out);
+    fclose(out);
+    printf("Folded stacks written to %s\n", file_name);
+}
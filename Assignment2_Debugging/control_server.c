@@ -0,0 +1,603 @@
+/*
+ * File Name: control_server.c
+ * Date October 19 2026
+ * Module Info: This module implements the binary control protocol for test harnesses. One process serves any number
+ * of sessions on a Unix socket through epoll, each session with its own emulator and memory, which xm23_memory is
+ * pointed at while the session's requests are handled. Requests may be pipelined, they are answered in order, and
+ * reads and writes move up to a whole memory in one request.
+ *
+ * Runs go through functional_step in slices of CONTROL_RUN_SLICE instructions, taking turns with the other sessions
+ * so one long run does not hold up the rest. Requests queued behind a run wait until it has finished.
+ */
+#include "emulation.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define CONTROL_LENGTH_SIZE 4
+#define CONTROL_INPUT_SIZE (CONTROL_MAX_REQUEST + CONTROL_LENGTH_SIZE)
+#define CONTROL_OUTPUT_INITIAL (1 << 12)
+#define CONTROL_RUN_SLICE (1 << 16)
+#define CONTROL_MAX_EVENTS 64
+#define CONTROL_LISTEN_BACKLOG 64
+#define CONTROL_PC_REGISTER PROG_COUNTER
+#define CONTROL_PSW_REGISTER REGFILE_SIZE
+
+typedef struct control_session
+{
+    int fd;
+    Emulator *emulator;
+    Memory memory[2];
+    unsigned char input[CONTROL_INPUT_SIZE];
+    size_t input_length;
+    unsigned char *output;
+    size_t output_length;
+    size_t output_sent;
+    size_t output_capacity;
+    size_t response_start; //offset of the response being built
+    bool waiting_to_write; //EPOLLOUT is registered
+    bool running;
+    bool run_limited;
+    unsigned long int run_end; //clock the run stops at when run_limited
+    int run_stop; //address the run stops before, or CONTROL_NO_STOP
+    struct control_session *next;
+}ControlSession;
+
+/* ---- little-endian encoding ---- */
+static unsigned short get_u16(const unsigned char *in)
+{
+    return (unsigned short)(in[0] | in[1] << 8);
+}
+
+static unsigned int get_u32(const unsigned char *in)
+{
+    return (unsigned int)in[0] | (unsigned int)in[1] << 8 | (unsigned int)in[2] << 16 | (unsigned int)in[3] << 24;
+}
+
+static unsigned long int get_u64(const unsigned char *in)
+{
+    return (unsigned long int)get_u32(in) | (unsigned long int)get_u32(in + 4) << 32;
+}
+
+/*
+ * @brief This function makes room for more bytes at the end of the output
+ * @return where to write them, or NULL if the output could not grow
+ */
+static unsigned char *reserve_output(ControlSession *session, size_t length)
+{
+    unsigned char *grown;
+    size_t capacity = session->output_capacity ? session->output_capacity : CONTROL_OUTPUT_INITIAL;
+    if (session->output_length + length > session->output_capacity)
+    {
+        while (capacity < session->output_length + length)
+        {
+            capacity *= 2;
+        }
+        grown = realloc(session->output, capacity);
+        if (grown == NULL)
+        {
+            return NULL;
+        }
+        session->output = grown;
+        session->output_capacity = capacity;
+    }
+    session->output_length += length;
+    return session->output + session->output_length - length;
+}
+
+static void put_bytes(ControlSession *session, const void *data, size_t length)
+{
+    unsigned char *out = reserve_output(session, length);
+    if (out != NULL)
+    {
+        memcpy(out, data, length);
+    }
+}
+
+static void put_u8(ControlSession *session, unsigned char value)
+{
+    put_bytes(session, &value, 1);
+}
+
+static void put_u16(ControlSession *session, unsigned short value)
+{
+    unsigned char out[2] = {value & 0xFF, value >> 8};
+    put_bytes(session, out, sizeof(out));
+}
+
+static void put_u64(ControlSession *session, unsigned long int value)
+{
+    unsigned char out[8];
+    for (int i = 0; i < 8; ++i)
+    {
+        out[i] = (unsigned char)(value >> (i * 8));
+    }
+    put_bytes(session, out, sizeof(out));
+}
+
+static void begin_response(ControlSession *session, CONTROL_STATUS status)
+{
+    session->response_start = session->output_length;
+    reserve_output(session, CONTROL_LENGTH_SIZE);
+    put_u8(session, status);
+}
+
+/*
+ * @brief This function fills in the length of the response begun by begin_response
+ */
+static void end_response(ControlSession *session)
+{
+    unsigned int length = (unsigned int)(session->output_length - session->response_start - CONTROL_LENGTH_SIZE);
+    unsigned char *out = session->output + session->response_start;
+    for (int i = 0; i < CONTROL_LENGTH_SIZE; ++i)
+    {
+        out[i] = (unsigned char)(length >> (i * 8));
+    }
+}
+
+static void respond_status(ControlSession *session, CONTROL_STATUS status)
+{
+    begin_response(session, status);
+    end_response(session);
+}
+
+/* ---- requests ---- */
+static void reset_session(ControlSession *session)
+{
+    free(session->emulator->branch_profile);
+    memset(session->emulator, 0, sizeof(Emulator));
+    init_emulator(session->emulator);
+    session->emulator->is_quiet = true;
+    memset(session->memory, 0, sizeof(session->memory));
+}
+
+static void handle_load(ControlSession *session, const unsigned char *payload, unsigned int length)
+{
+    char path[PATH_MAX];
+    FILE *file;
+    if (length == 0 || length >= sizeof(path))
+    {
+        respond_status(session, CONTROL_BAD_REQUEST);
+        return;
+    }
+    memcpy(path, payload, length);
+    path[length] = '\0';
+    //load only reports a missing file on stdout, so check it can be opened first
+    if ((file = fopen(path, "r")) == NULL)
+    {
+        respond_status(session, CONTROL_LOAD_FAILED);
+        return;
+    }
+    fclose(file);
+    reset_session(session);
+    load(input_file, path, session->emulator);
+    session->emulator->is_memset = true;
+    respond_status(session, CONTROL_OK);
+}
+
+/*
+ * @brief checks a memory request's space and range, the range may not wrap past the end of memory
+ */
+static bool valid_range(unsigned char space, unsigned long int address, unsigned long int length)
+{
+    return (space == I_MEMORY || space == D_MEMORY) && address + length <= (BYTE_MEMORY_SIZE);
+}
+
+static void handle_read_memory(ControlSession *session, const unsigned char *payload, unsigned int length)
+{
+    unsigned short address;
+    unsigned int count;
+    if (length != 7 || !valid_range(payload[0], address = get_u16(payload + 1), count = get_u32(payload + 3)))
+    {
+        respond_status(session, CONTROL_BAD_REQUEST);
+        return;
+    }
+    begin_response(session, CONTROL_OK);
+    put_bytes(session, &xm23_memory[payload[0]].byte[address], count);
+    end_response(session);
+}
+
+static void handle_write_memory(ControlSession *session, const unsigned char *payload, unsigned int length)
+{
+    unsigned short address;
+    if (length < 3 || !valid_range(payload[0], address = get_u16(payload + 1), length - 3))
+    {
+        respond_status(session, CONTROL_BAD_REQUEST);
+        return;
+    }
+    memcpy(&xm23_memory[payload[0]].byte[address], payload + 3, length - 3);
+    respond_status(session, CONTROL_OK);
+}
+
+static void handle_read_state(ControlSession *session)
+{
+    Emulator *emulator = session->emulator;
+    begin_response(session, CONTROL_OK);
+    for (int reg = 0; reg < PROG_COUNTER; ++reg)
+    {
+        put_u16(session, emulator->reg_file[REGISTER][reg].word);
+    }
+    put_u16(session, next_execute_address(emulator));
+    put_u16(session, emulator->psw.word);
+    put_u64(session, emulator->clock);
+    end_response(session);
+}
+
+static void handle_write_register(ControlSession *session, const unsigned char *payload, unsigned int length)
+{
+    Emulator *emulator = session->emulator;
+    unsigned short value;
+    if (length != 3 || payload[0] > CONTROL_PSW_REGISTER)
+    {
+        respond_status(session, CONTROL_BAD_REQUEST);
+        return;
+    }
+    value = get_u16(payload + 1);
+    if (payload[0] == CONTROL_PC_REGISTER)
+    {
+        redirect_execution(emulator, value);
+    }
+    else if (payload[0] == CONTROL_PSW_REGISTER)
+    {
+        emulator->psw.word = value;
+    }
+    else
+    {
+        emulator->reg_file[REGISTER][payload[0]].word = value;
+    }
+    respond_status(session, CONTROL_OK);
+}
+
+static void handle_run(ControlSession *session, const unsigned char *payload, unsigned int length)
+{
+    unsigned long int clocks;
+    if (length != 12)
+    {
+        respond_status(session, CONTROL_BAD_REQUEST);
+        return;
+    }
+    clocks = get_u64(payload);
+    session->run_limited = clocks != 0;
+    session->run_end = session->emulator->clock + clocks;
+    session->run_stop = (int)get_u32(payload + 8);
+    session->running = true;
+}
+
+/*
+ * @brief This function runs part of the session's run, answering the request once the run stops
+ */
+static void run_slice(ControlSession *session)
+{
+    Emulator *emulator = session->emulator;
+    CONTROL_STOP_REASONS reason;
+    bool executed;
+    for (int step = 0; step < CONTROL_RUN_SLICE; ++step)
+    {
+        if (session->run_limited && emulator->clock >= session->run_end)
+        {
+            reason = CONTROL_STOP_CLOCKS;
+            goto stopped;
+        }
+        if (emulator->psw.bits.sleep)
+        {
+            //nothing wakes a sleeping core, a run for a number of clocks sleeps through them
+            reason = session->run_limited && sleep_until_clock(emulator, session->run_end) ? CONTROL_STOP_CLOCKS
+                                                                                         : CONTROL_STOP_HALTED;
+            goto stopped;
+        }
+        executed = functional_step(emulator);
+        if (executed && branched_to_self(emulator))
+        {
+            reason = CONTROL_STOP_HALTED;
+            goto stopped;
+        }
+        //only after an instruction, the flush bubble left by the branch that reached the address is not progress
+        if (executed && session->run_stop == next_execute_address(emulator))
+        {
+            reason = CONTROL_STOP_ADDRESS;
+            goto stopped;
+        }
+    }
+    return;
+stopped:
+    settle_pipeline(emulator);
+    session->running = false;
+    begin_response(session, CONTROL_OK);
+    put_u8(session, reason);
+    put_u64(session, emulator->clock);
+    end_response(session);
+}
+
+static void handle_request(ControlSession *session, const unsigned char *request, unsigned int length)
+{
+    const unsigned char *payload = request + 1;
+    unsigned int payload_length = length - 1;
+    switch (request[0])
+    {
+        case CONTROL_LOAD:
+            handle_load(session, payload, payload_length);
+            break;
+        case CONTROL_RESET:
+            reset_session(session);
+            respond_status(session, CONTROL_OK);
+            break;
+        case CONTROL_READ_MEMORY:
+            handle_read_memory(session, payload, payload_length);
+            break;
+        case CONTROL_WRITE_MEMORY:
+            handle_write_memory(session, payload, payload_length);
+            break;
+        case CONTROL_RUN:
+            handle_run(session, payload, payload_length);
+            break;
+        case CONTROL_READ_STATE:
+            handle_read_state(session);
+            break;
+        case CONTROL_WRITE_REGISTER:
+            handle_write_register(session, payload, payload_length);
+            break;
+        default:
+            respond_status(session, CONTROL_BAD_REQUEST);
+            break;
+    }
+}
+
+/*
+ * @brief This function answers every complete request in the input, stopping at a run that has not finished
+ * @return false if a request length is invalid and the session has to be closed
+ */
+static bool process_requests(ControlSession *session)
+{
+    size_t offset = 0;
+    unsigned int length;
+    xm23_memory = session->memory;
+    while (!session->running && session->input_length - offset >= CONTROL_LENGTH_SIZE)
+    {
+        length = get_u32(session->input + offset);
+        if (length == 0 || length > CONTROL_MAX_REQUEST)
+        {
+            return false;
+        }
+        if (session->input_length - offset - CONTROL_LENGTH_SIZE < length)
+        {
+            break;
+        }
+        handle_request(session, session->input + offset + CONTROL_LENGTH_SIZE, length);
+        offset += CONTROL_LENGTH_SIZE + length;
+    }
+    memmove(session->input, session->input + offset, session->input_length - offset);
+    session->input_length -= offset;
+    return true;
+}
+
+/* ---- sessions ---- */
+/*
+ * @brief This function sends as much of the output as the socket takes, waiting for EPOLLOUT for the rest
+ * @return false if the connection failed
+ */
+static bool flush_output(int epoll_fd, ControlSession *session)
+{
+    struct epoll_event event = {.data.ptr = session};
+    ssize_t sent;
+    while (session->output_sent < session->output_length)
+    {
+        sent = send(session->fd, session->output + session->output_sent,
+                    session->output_length - session->output_sent, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        if (sent <= 0)
+        {
+            return false;
+        }
+        session->output_sent += (size_t)sent;
+    }
+    if (session->output_sent == session->output_length)
+    {
+        session->output_sent = 0;
+        session->output_length = 0;
+    }
+    if (session->waiting_to_write != (session->output_length != 0))
+    {
+        session->waiting_to_write = session->output_length != 0;
+        event.events = EPOLLIN | (session->waiting_to_write ? EPOLLOUT : 0);
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, session->fd, &event);
+    }
+    return true;
+}
+
+/*
+ * @brief This function reads what has arrived and answers the complete requests
+ * @return false if the client disconnected or sent an invalid request
+ */
+static bool read_requests(ControlSession *session)
+{
+    ssize_t received;
+    while (session->input_length < CONTROL_INPUT_SIZE)
+    {
+        received = recv(session->fd, session->input + session->input_length,
+                        CONTROL_INPUT_SIZE - session->input_length, 0);
+        if (received < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        if (received <= 0)
+        {
+            return false;
+        }
+        session->input_length += (size_t)received;
+        if (!process_requests(session))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static ControlSession *open_session(int epoll_fd, int fd)
+{
+    ControlSession *session = calloc(1, sizeof(ControlSession));
+    struct epoll_event event = {.events = EPOLLIN};
+    if (session == NULL || (session->emulator = calloc(1, sizeof(Emulator))) == NULL)
+    {
+        free(session);
+        return NULL;
+    }
+    session->fd = fd;
+    init_emulator(session->emulator);
+    session->emulator->is_quiet = true;
+    event.data.ptr = session;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+    {
+        free(session->emulator->branch_profile);
+        free(session->emulator);
+        free(session);
+        return NULL;
+    }
+    return session;
+}
+
+static void close_session(ControlSession **sessions, ControlSession *session)
+{
+    ControlSession **link = sessions;
+    while (*link != session)
+    {
+        link = &(*link)->next;
+    }
+    *link = session->next;
+    close(session->fd);
+    free(session->output);
+    free(session->emulator->branch_profile);
+    free(session->emulator);
+    free(session);
+}
+
+static int open_listener(const char *path)
+{
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    int fd;
+    if (strlen(path) >= sizeof(address.sun_path) ||
+        (fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0)) < 0)
+    {
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(fd, CONTROL_LISTEN_BACKLOG) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void accept_sessions(int epoll_fd, int listener, ControlSession **sessions)
+{
+    ControlSession *session;
+    int fd;
+    while ((fd = accept(listener, NULL, NULL)) >= 0)
+    {
+        if (fcntl(fd, F_SETFL, O_NONBLOCK) < 0 || (session = open_session(epoll_fd, fd)) == NULL)
+        {
+            close(fd);
+            continue;
+        }
+        session->next = *sessions;
+        *sessions = session;
+    }
+}
+
+/*
+ * @brief This function serves control sessions on the Unix socket until ctrl-c is pressed
+ * @return 0 once stopped, -1 if the server could not be started
+ */
+int run_control_server(const char *path)
+{
+    struct epoll_event event = {.events = EPOLLIN};
+    struct epoll_event events[CONTROL_MAX_EVENTS];
+    ControlSession *sessions = NULL;
+    ControlSession *session;
+    ControlSession *next;
+    Memory *own_memory = xm23_memory;
+    int listener = open_listener(path);
+    int epoll_fd = epoll_create1(0);
+    int ready;
+    bool running;
+
+    if (listener < 0 || epoll_fd < 0)
+    {
+        printf("Could not listen on %s\n", path);
+        if (listener >= 0) close(listener);
+        if (epoll_fd >= 0) close(epoll_fd);
+        return -1;
+    }
+    event.data.ptr = NULL; //the listener
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listener, &event);
+    stop_loop = 0;
+    signal(SIGINT, int_handler);
+    printf("Serving control sessions on %s\n", path);
+    fflush(stdout);
+
+    running = false;
+    while (!stop_loop)
+    {
+        //while a run is in progress only poll, so the runs keep taking turns
+        ready = epoll_wait(epoll_fd, events, CONTROL_MAX_EVENTS, running ? 0 : -1);
+        for (int i = 0; i < ready; ++i)
+        {
+            session = events[i].data.ptr;
+            if (session == NULL)
+            {
+                accept_sessions(epoll_fd, listener, &sessions);
+                continue;
+            }
+            if (((events[i].events & EPOLLOUT) && !flush_output(epoll_fd, session)) ||
+                ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !read_requests(session)) ||
+                !flush_output(epoll_fd, session))
+            {
+                close_session(&sessions, session);
+            }
+        }
+        running = false;
+        for (session = sessions; session != NULL; session = next)
+        {
+            next = session->next;
+            if (!session->running)
+            {
+                continue;
+            }
+            xm23_memory = session->memory;
+            run_slice(session);
+            if ((!session->running && !process_requests(session)) || !flush_output(epoll_fd, session))
+            {
+                close_session(&sessions, session);
+                continue;
+            }
+            running |= session->running;
+        }
+    }
+    while (sessions != NULL)
+    {
+        close_session(&sessions, sessions);
+    }
+    stop_loop = 0;
+    xm23_memory = own_memory;
+    close(epoll_fd);
+    close(listener);
+    unlink(path);
+    printf("Control server stopped\n");
+    return 0;
+}
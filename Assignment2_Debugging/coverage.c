@@ -0,0 +1,257 @@
+/*
+ * File Name: coverage.c
+ * Date October 19 2026
+ * Module Info: This module records which I-memory words have executed, one bit per word so the whole bitmap is
+ * 4 KB, and reports coverage against the assembler's .lis listing. E0 and the functional executor set the bit of
+ * every instruction they execute while coverage is on.
+ *
+ * Runs are merged by OR-ing bitmaps. A saved bitmap is a file holding the COVERAGE_BITMAP_WORDS words in the
+ * host's byte order; saving ORs the run into the file under an exclusive lock, so batch runs started in parallel
+ * can all accumulate into one file without losing each other's bits.
+ */
+#include "emulation.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+
+#define MAX_LISTING_LINE 512
+
+#define COVERED(coverage, address) (((coverage)->bits[(address) >> 7] >> (((address) >> 1) & 63)) & 1)
+
+/*
+ * @brief This function starts recording coverage, clearing anything recorded before
+ * @return false if the bitmap could not be allocated
+ */
+bool enable_coverage(Emulator *emulator)
+{
+    if (emulator->coverage == NULL)
+    {
+        emulator->coverage = malloc(sizeof(CoverageBitmap));
+    }
+    if (emulator->coverage == NULL)
+    {
+        return false;
+    }
+    memset(emulator->coverage, 0, sizeof(CoverageBitmap));
+    return true;
+}
+
+void disable_coverage(Emulator *emulator)
+{
+    free(emulator->coverage);
+    emulator->coverage = NULL;
+}
+
+void merge_coverage(CoverageBitmap *into, const CoverageBitmap *from)
+{
+    for (int i = 0; i < COVERAGE_BITMAP_WORDS; ++i)
+    {
+        into->bits[i] |= from->bits[i];
+    }
+}
+
+static bool read_whole(int fd, void *data, size_t length)
+{
+    ssize_t done;
+    for (size_t offset = 0; offset < length; offset += (size_t)done)
+    {
+        done = pread(fd, (char *)data + offset, length - offset, (off_t)offset);
+        if (done <= 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool write_whole(int fd, const void *data, size_t length)
+{
+    ssize_t done;
+    for (size_t offset = 0; offset < length; offset += (size_t)done)
+    {
+        done = pwrite(fd, (const char *)data + offset, length - offset, (off_t)offset);
+        if (done <= 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * @brief This function ORs a saved bitmap into coverage
+ * @return false if the file could not be read or is not a bitmap
+ */
+bool load_coverage(CoverageBitmap *coverage, const char *path)
+{
+    CoverageBitmap saved;
+    int fd = open(path, O_RDONLY);
+    bool loaded;
+    if (fd < 0)
+    {
+        return false;
+    }
+    loaded = lseek(fd, 0, SEEK_END) == (off_t)sizeof(CoverageBitmap) && read_whole(fd, &saved, sizeof(saved));
+    close(fd);
+    if (loaded)
+    {
+        merge_coverage(coverage, &saved);
+    }
+    return loaded;
+}
+
+/*
+ * @brief This function ORs coverage into a saved bitmap, creating it if needed, and leaves the merged bitmap in
+ * coverage
+ * @return false if the file could not be read or written
+ */
+bool accumulate_coverage(CoverageBitmap *coverage, const char *path)
+{
+    CoverageBitmap saved;
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    off_t length;
+    bool written;
+    if (fd < 0)
+    {
+        return false;
+    }
+    if (flock(fd, LOCK_EX) < 0)
+    {
+        close(fd);
+        return false;
+    }
+    length = lseek(fd, 0, SEEK_END);
+    if (length == (off_t)sizeof(CoverageBitmap) && read_whole(fd, &saved, sizeof(saved)))
+    {
+        merge_coverage(coverage, &saved);
+    }
+    else if (length != 0)
+    {
+        //not a bitmap, leave it alone
+        close(fd);
+        return false;
+    }
+    written = write_whole(fd, coverage, sizeof(CoverageBitmap));
+    //closing releases the lock
+    close(fd);
+    return written;
+}
+
+static int count_covered(const CoverageBitmap *coverage)
+{
+    int covered = 0;
+    for (int i = 0; i < COVERAGE_BITMAP_WORDS; ++i)
+    {
+        covered += __builtin_popcountll(coverage->bits[i]);
+    }
+    return covered;
+}
+
+/*
+ * @brief This function prints the listing with each instruction marked executed (+) or never executed (-), then
+ * the totals, without a listing it prints the executed address ranges and the labels they start in
+ * @param listing_path the .lis file, or NULL
+ */
+void print_coverage_report(Emulator *emulator, const char *listing_path)
+{
+    const CoverageBitmap *coverage = emulator->coverage;
+    char line[MAX_LISTING_LINE];
+    FILE *listing;
+    unsigned int address;
+    int source_start;
+    int instructions = 0;
+    int executed = 0;
+    int start = -1;
+
+    if (listing_path == NULL)
+    {
+        printf("== Coverage (%d words executed) ==\n", count_covered(coverage));
+        for (int word = 0; word <= (WORD_MEMORY_SIZE); ++word)
+        {
+            if (word < (WORD_MEMORY_SIZE) && COVERED(coverage, word << 1))
+            {
+                start = start < 0 ? word : start;
+            }
+            else if (start >= 0)
+            {
+                printf("%04X..%04X  %d words%s\n", start << 1, (word << 1) - 2, word - start,
+                       symbol_suffix(emulator, (unsigned short)(start << 1)));
+                start = -1;
+            }
+        }
+        return;
+    }
+    listing = fopen(listing_path, "r");
+    if (listing == NULL)
+    {
+        printf("Could not open listing %s\n", listing_path);
+        return;
+    }
+    printf("== Coverage of %s ==\n", listing_path);
+    while (fgets(line, sizeof(line), listing) != NULL)
+    {
+        if (!parse_listing_word(line, &address, &source_start))
+        {
+            printf("    %s", line);
+        }
+        else
+        {
+            instructions++;
+            executed += COVERED(coverage, address);
+            printf("  %c %s", COVERED(coverage, address) ? '+' : '-', line);
+        }
+    }
+    fclose(listing);
+    printf("Coverage: %d of %d listed words executed (%.1f%%), %d words executed in all\n", executed, instructions,
+           instructions ? 100.0 * executed / instructions : 0.0, count_covered(coverage));
+}
+
+/*
+ * @brief This function turns coverage on or off, merges saved bitmaps and prints the report
+ */
+void coverage_menu(Emulator *emulator)
+{
+    char command;
+    char file_name[MAX_RECORD_LEN];
+    printf("Enter E to start recording, O to stop, M <file> to merge a saved bitmap in, S <file> to merge into a "
+           "saved bitmap, R <file.lis|-> for a report: ");
+    if (scanf(" %c", &command) != 1)
+    {
+        return;
+    }
+    command = (char)toupper(command);
+    if (command == 'E')
+    {
+        printf(enable_coverage(emulator) ? "Recording coverage\n" : "Could not allocate the coverage bitmap\n");
+        return;
+    }
+    if (command == 'O')
+    {
+        disable_coverage(emulator);
+        printf("Coverage off\n");
+        return;
+    }
+    if ((command != 'M' && command != 'S' && command != 'R') || scanf("%70s", file_name) != 1)
+    {
+        printf("Invalid coverage command\n");
+        return;
+    }
+    if (emulator->coverage == NULL)
+    {
+        printf("Coverage is not being recorded, enter E first\n");
+        return;
+    }
+    switch (command)
+    {
+        case 'M':
+            printf(load_coverage(emulator->coverage, file_name) ? "Merged %s\n" : "Could not read %s\n", file_name);
+            break;
+        case 'S':
+            printf(accumulate_coverage(emulator->coverage, file_name) ? "Saved to %s\n" : "Could not save to %s\n",
+                   file_name);
+            break;
+        default:
+            print_coverage_report(emulator, strcmp(file_name, "-") == 0 ? NULL : file_name);
+            break;
+    }
+}
@@ -124,8 +124,21 @@ void set_breakpoint(Emulator *emulator)
 {
     //temporay breakpoint to check if it is valid before setting it
     int temp_breakpoint;
-    printf("Enter a breakpoint (must be >%04x): ", emulator->reg_file[REGISTER][PROG_COUNTER].word);
-    scanf("%x",&temp_breakpoint);
+    char breakpoint_text[MAX_SYMBOL_LEN];
+    printf("Enter a breakpoint, a label or hex (must be >%04x): ", emulator->reg_file[REGISTER][PROG_COUNTER].word);
+    if (scanf("%31s", breakpoint_text) != 1 || !parse_code_address(emulator, breakpoint_text, &temp_breakpoint))
+    {
+        printf("Invalid breakpoint\n");
+        return;
+    }
+    set_breakpoint_address(emulator, temp_breakpoint);
+}
+
+/*
+ * @brief This function sets the breakpoint to an address from the .LIS file, used by the menu and the command line
+ */
+void set_breakpoint_address(Emulator *emulator, int temp_breakpoint)
+{
     //if the breakpoint is not even, make it even for word addressing
     temp_breakpoint = (temp_breakpoint % 2 == 0) ? temp_breakpoint : temp_breakpoint - 1;
     //check if program has passed breakpoint already
@@ -139,7 +152,8 @@ void set_breakpoint(Emulator *emulator)
         //add four to adjust breakpoint value given the nops from starting of pipeline
         emulator->breakpoint = temp_breakpoint + PIPELINE_ADJUSTMENT;
 
-        printf("Set breakpoint @ %04x: .LIS value %04x\n", emulator->breakpoint, emulator->breakpoint - PIPELINE_ADJUSTMENT);
+        printf("Set breakpoint @ %04x: .LIS value %04x%s\n", emulator->breakpoint, emulator->breakpoint - PIPELINE_ADJUSTMENT,
+               symbol_suffix(emulator, (unsigned short)temp_breakpoint));
     }
 }
 
@@ -159,6 +173,7 @@ void decode_instruction(Emulator *emulator)
     instruction_data current_instruction;
     //shift starting address right for word addressing since word memory is half the size of byte memory
     current_instruction.word = emulator->instruction_register;
+    emulator->decoded_invalid = false;
     if (current_instruction.byte[MSB] < ARITHMETIC_LOWER_BOUND)
     {
         parse_branch_block(emulator, current_instruction);
@@ -189,6 +204,8 @@ void decode_instruction(Emulator *emulator)
     {
         if(current_instruction.word != 0x0000) {
             printf("Invalid instruction: %04X\n", current_instruction.word);
+            emulator->stats.invalid_instructions++;
+            emulator->decoded_invalid = true;
         }
         else {
             emulator->opcode = -1;
@@ -221,7 +238,9 @@ void parse_branch_block(Emulator *emulator, instruction_data data) {
     else
     {
         //save pc to link reg
-        emulator->reg_file[REGISTER][LINK_REG].word = emulator->reg_file[REGISTER][PROG_COUNTER].word - BUBBLE_OFFSET;
+        //return address is the word after the BL, taken from where it was fetched since a predictor may have
+        //already moved the PC onto the call target
+        emulator->reg_file[REGISTER][LINK_REG].word = emulator->decode_address + BUBBLE_OFFSET;
         emulator->offset = EXTRACT_BITS(13,0, data.word) << 1; //extract 13 bits
         emulator->opcode = bl;
         emulator->offset |= (TEST_BIT(data.word , BIT12)) ? 0xC000 : 0x0000; //sign extend
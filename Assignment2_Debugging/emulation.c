@@ -23,108 +23,208 @@ void int_handler(int signum)
 #define IS_EVEN(x) (x % 2 == 0)
 #define EVEN 1
 #define ODD 0
+//the pipeline trace is skipped when running quietly for benchmarks and batch runs
+#define TRACE(emulator, ...) do { if (!(emulator)->is_quiet) printf(__VA_ARGS__); } while (0)
+
 /*
- * @brief This function implements the simulation of the emulator, it provides an
- * update to clock cycles and handles the calling of functions according to pipeline
- * stages
+ * @brief This function advances the pipeline by a single clock tick, calling the stage functions for an even
+ * (E1, F0, D0) or odd (F1, E0) tick, and then increments the clock
  */
-
-void run_emulator(Emulator *emulator)
+void pipeline_clock(Emulator *emulator)
 {
-    //allows us to handle SIGINT (CTRL-C gracefully and stop the while loop) without exiting the process
-    unsigned short previously_decoded;
-    signal(SIGINT, int_handler);
-    if(emulator->has_started)
+    //this if else, combo implements the pipeline
+    if(IS_EVEN(emulator->clock))
     {
-        printf("Emulator is already running\n");
-        return;
-    }
-    emulator->has_started = true;
-    printf("CLK    PC    INST    FETCH     DECODE    EXECUTE        PSW\n");
 
-    do
-    {
-        //this if else, combo implements the pipeline
-        if(IS_EVEN(emulator->clock))
+        TRACE(emulator, "%-5lu %04X   %04X   ", emulator->clock, emulator->reg_file[REGISTER][PROG_COUNTER].word, xm23_memory[I_MEMORY].word[emulator->reg_file[REGISTER][PROG_COUNTER].word >> 1]);
+
+        if(emulator->xCTRL != I_MEMORY && emulator->xCTRL != NO_ACCESS)
         {
+            execute_1(emulator); //e1
+            emulator->xCTRL = NO_ACCESS;
+        }
 
-            printf("%-5lu %04X   %04X   ", emulator->clock, emulator->reg_file[REGISTER][PROG_COUNTER].word, xm23_memory[I_MEMORY].word[emulator->reg_file[REGISTER][PROG_COUNTER].word >> 1]);
+        TRACE(emulator, "F0: %04X  ", emulator->reg_file[REGISTER][PROG_COUNTER].word);
 
-            if(emulator->xCTRL != I_MEMORY && emulator->xCTRL != NO_ACCESS)
-            {
-                execute_1(emulator); //e1
-                emulator->xCTRL = NO_ACCESS;
-            }
+        //the instruction register was filled from IMAR by the last F1, remember where it came from
+        emulator->decode_address = emulator->i_control.IMAR;
+        fetch_instruction(emulator, EVEN); //f0
+
+        if(emulator->hazard_control.d_bubble)
+        {
+            TRACE(emulator, "D0: BUB.   \n");
+            emulator->hazard_control.d_bubble = false;
+            emulator->stats.decode_bubbles++;
+        }
+        else
+        {
+            decode_instruction(emulator); //d0
+            TRACE(emulator, "D0: %04X   \n", emulator->instruction_register);
+        }
+        emulator->previously_decoded = emulator->instruction_register;
 
-            printf("F0: %04X  ", emulator->reg_file[REGISTER][PROG_COUNTER].word);
+    }
+    else
+    {
+        fetch_instruction(emulator, ODD); //f1
 
-            fetch_instruction(emulator, EVEN); //f0
+        TRACE(emulator, "%-5lu               F1: %04X             ",emulator->clock, emulator->i_control.IMBR);
 
-            if(emulator->hazard_control.d_bubble)
-            {
-                printf("D0: BUB.   \n");
-                emulator->hazard_control.d_bubble = false;
-            }
-            else
-            {
-                decode_instruction(emulator); //d0
-                printf("D0: %04X   \n", emulator->instruction_register);
-            }
-            previously_decoded = emulator->instruction_register;
+        if(emulator->hazard_control.e_bubble)
+        {
+            emulator->hazard_control.e_bubble = false;
+            emulator->stats.execute_bubbles++;
+            TRACE(emulator, "E0: BUB.    VNZC: %1d%1d%1d%1d\n", emulator->psw.bits.overflow, emulator->psw.bits.negative, emulator->psw.bits.zero, emulator->psw.bits.carry);
 
         }
         else
         {
-            fetch_instruction(emulator, ODD); //f1
+            emulator->execute_address = emulator->decode_address;
+            execute_0(emulator); //e0
+            TRACE(emulator, "E0: %04X    VNZC: %1d%1d%1d%1d%s\n", emulator->previously_decoded, emulator->psw.bits.overflow, emulator->psw.bits.negative, emulator->psw.bits.zero, emulator->psw.bits.carry,
+                  symbol_suffix(emulator, emulator->execute_address));
 
-            printf("%-5lu               F1: %04X             ",emulator->clock, emulator->i_control.IMBR);
+        }
+    }
+    //after pipeline stages increment clock
+    emulator->clock++;
+    emulator->stats.clocks++;
+}
 
-            if(emulator->hazard_control.e_bubble)
-            {
-                emulator->hazard_control.e_bubble = false;
-                printf("E0: BUB.    VNZC: %1d%1d%1d%1d\n", emulator->psw.bits.overflow, emulator->psw.bits.negative, emulator->psw.bits.zero, emulator->psw.bits.carry);
+/*
+ * @brief true when the instruction E0 has just executed was a branch to its own address, the next instruction
+ * executed is the branch again and nothing can change that
+ */
+static bool branched_in_place(Emulator *emulator, unsigned long int retired_before)
+{
+    return emulator->stats.retired != retired_before && emulator->opcode <= bra &&
+           next_execute_address(emulator) == emulator->execute_address;
+}
 
-            }
-            else
-            {
-                execute_0(emulator); //e0
-                printf("E0: %04X    VNZC: %1d%1d%1d%1d\n", previously_decoded, emulator->psw.bits.overflow, emulator->psw.bits.negative, emulator->psw.bits.zero, emulator->psw.bits.carry);
+/*
+ * @brief This function implements the simulation of the emulator, it provides an
+ * update to clock cycles and handles the calling of functions according to pipeline
+ * stages. It runs until something stops it and returns why, calling it again resumes where it stopped
+ * @param clock_budget clocks to run before returning STOP_CLOCK_BUDGET, 0 for no budget
+ */
+StopReason run_emulator(Emulator *emulator, unsigned long int clock_budget)
+{
+    unsigned long int budget_end = emulator->clock + clock_budget;
+    unsigned long int retired;
+    //allows us to handle SIGINT (CTRL-C gracefully and stop the while loop) without exiting the process
+    signal(SIGINT, int_handler);
+    if(!emulator->has_started)
+    {
+        emulator->has_started = true;
+        TRACE(emulator, "CLK    PC    INST    FETCH     DECODE    EXECUTE        PSW\n");
+        if (emulator->sampling.mode != FAST_FORWARD_OFF && emulator->sampling.windows == 0)
+        {
+            fast_forward(emulator, emulator->sampling.mode, emulator->sampling.target);
+        }
+    }
 
-            }
+    emulator->idle.loop_laps = 0;
 
-            //break after instruction has been executed
-            if(emulator->reg_file[REGISTER][PROG_COUNTER].word == emulator->breakpoint)
+    while (true)
+    {
+        retired = emulator->stats.retired;
+        if(emulator->psw.bits.sleep || (emulator->idle.asleep && !IS_EVEN(emulator->clock)))
+        {
+            if(!sleep_until_event(emulator, clock_budget != 0 ? budget_end : 0))
             {
-                emulator->has_started =false;
-                emulator->hide_menu_prompt = false;
-                menu(emulator);
+                emulator->has_started = false;
+                return STOP_HALT;
             }
         }
-        //after pipeline stages increment clock
-        emulator->clock++;
-        //pause every clocktick
-        if(emulator->stop_on_clock && emulator->is_single_step == true)
+        else
         {
-            menu(emulator);
+            emulator->idle.asleep = false;
+            pipeline_clock(emulator);
         }
-            //pause every pc increment
-        else if ((emulator->is_single_step == true && IS_EVEN(emulator->clock)) && emulator->stop_on_clock == false)
+        //an even clock means E0 has just run
+        if(IS_EVEN(emulator->clock) && branched_in_place(emulator, retired) &&
+           !skip_idle_loop(emulator, clock_budget != 0 ? budget_end : 0))
         {
-            menu(emulator);
+            emulator->has_started = false;
+            return STOP_HALT;
         }
-
-        else if(stop_loop)
+        //break after instruction has been executed
+        if(IS_EVEN(emulator->clock) && emulator->reg_file[REGISTER][PROG_COUNTER].word == emulator->breakpoint)
+        {
+            return STOP_BREAKPOINT;
+        }
+        if(emulator->clock_limit != 0 && emulator->clock >= emulator->clock_limit)
+        {
+            emulator->has_started = false;
+            return STOP_CLOCK_LIMIT;
+        }
+        if(sample_window_elapsed(emulator))
+        {
+            emulator->has_started = false;
+            return STOP_WINDOW_END;
+        }
+        if(stop_loop)
         {
             //resetting the signal handler
             signal(SIGINT, int_handler);
             stop_loop = 0;
-            //pausing the emulator
-            printf("Halting Emulator\n");
             emulator->is_user_interrupt = true;
-            menu(emulator);
+            return STOP_INTERRUPT;
+        }
+        //pause every clocktick, or every pc increment
+        if(emulator->is_single_step && (emulator->stop_on_clock || IS_EVEN(emulator->clock)))
+        {
+            return STOP_STEP;
+        }
+        if(clock_budget != 0 && emulator->clock >= budget_end)
+        {
+            return STOP_CLOCK_BUDGET;
+        }
+        if(emulator->sample_profile != NULL && emulator->clock >= emulator->sample_profile->next_check_clock)
+        {
+            sample_clock(emulator);
         }
-    } while (emulator->has_started);
-    printf("EMULATION ENDED WITH PC: %d\nCLOCK: %d", emulator->reg_file[REGISTER][PROG_COUNTER].word, emulator->clock);
+    }
+}
+
+/*
+ * @brief This function reports why run_emulator returned, printing the end of emulation once the run is over
+ */
+void report_stop(Emulator *emulator, StopReason reason)
+{
+    switch (reason)
+    {
+        case STOP_BREAKPOINT:
+            printf("Breakpoint reached\n");
+            break;
+        case STOP_INTERRUPT:
+            printf("Halting Emulator\n");
+            break;
+        case STOP_HALT:
+            if(emulator->psw.bits.sleep)
+            {
+                printf("Program halted, asleep after %04X%s with nothing to wake it\n", emulator->execute_address,
+                       symbol_suffix(emulator, emulator->execute_address));
+                break;
+            }
+            printf("Program halted, branch to itself at %04X%s\n", emulator->execute_address,
+                   symbol_suffix(emulator, emulator->execute_address));
+            break;
+        case STOP_CLOCK_LIMIT:
+            printf("Clock limit reached\n");
+            break;
+        case STOP_WINDOW_END:
+            printf("Detailed window ended at clock %lu\n", emulator->clock);
+            break;
+        case STOP_STEP:
+        case STOP_CLOCK_BUDGET:
+            break;
+    }
+    if(!emulator->has_started)
+    {
+        printf("EMULATION ENDED WITH PC: %d\nCLOCK: %d\n", emulator->reg_file[REGISTER][PROG_COUNTER].word, emulator->clock);
+        print_statistics(emulator);
+    }
 }
 
 /*
@@ -137,8 +237,8 @@ void fetch_instruction(Emulator *emulator, int even)
     {
         //set the IMAR to the current program counter
         emulator->i_control.IMAR = emulator->reg_file[REGISTER][PROG_COUNTER].word;
-        //get a new program counter
-        emulator->reg_file[REGISTER][PROG_COUNTER].word += 2;
+        //get a new program counter, the next word unless the predictor redirects fetch to a branch target
+        emulator->reg_file[REGISTER][PROG_COUNTER].word = predict_next_fetch(emulator, emulator->i_control.IMAR);
         //set xCTRL for the memory controller
         emulator->xCTRL = I_MEMORY;
     }
@@ -161,9 +261,29 @@ void memory_controller(Emulator *emulator)
     if(emulator->xCTRL == I_MEMORY )
     {
         emulator->i_control.IMBR = xm23_memory[I_MEMORY].word[emulator->i_control.IMAR >> 1];
+        if (emulator->caches[I_MEMORY] != NULL)
+        {
+            cache_access(emulator->caches[I_MEMORY], emulator->i_control.IMAR, false);
+        }
     }
     else
     {
+        if (emulator->perf_counters.mapped && emulator->d_control.DMAR >= PERF_COUNTER_BASE &&
+            emulator->xCTRL != NO_ACCESS && emulator->xCTRL != D_MEMORY)
+        {
+            //device registers are not memory, they bypass the D-cache and the access profile
+            perf_counter_access(emulator);
+            return;
+        }
+        if (emulator->caches[D_MEMORY] != NULL && emulator->xCTRL != NO_ACCESS && emulator->xCTRL != D_MEMORY)
+        {
+            cache_access(emulator->caches[D_MEMORY], emulator->d_control.DMAR,
+                         emulator->xCTRL == D_WRITE || emulator->xCTRL == D_WRITE_B);
+        }
+        if (emulator->access_profile != NULL && emulator->xCTRL != NO_ACCESS && emulator->xCTRL != D_MEMORY)
+        {
+            profile_access(emulator);
+        }
         switch (emulator->xCTRL)
         {
             case D_READ:
@@ -196,6 +316,8 @@ void init_emulator(Emulator *emulator)
     emulator->xCTRL = NO_ACCESS;
     emulator->hazard_control.d_bubble = true;
     emulator->hazard_control.e_bubble = true;
+    emulator->branch_profile = calloc(WORD_MEMORY_SIZE, sizeof(BranchSite));
+    init_alu_tables();
     instruction_data reg_file[REG_FILE_OPTIONS][REGFILE_SIZE] = {
             {
                     { .word = 0 }, { .word = 0 }, { .word = 0 }, { .word = 0 },
@@ -213,7 +335,21 @@ void print_menu_options()
     printf("Commands:\n"
            "Begin Emulation (G)\nEnable Single Step (S)\nLoad (L)\nDisplay Memory (M)\nPrint PSW (P)\nPrint Registers (R)"
            "\nModify Register Values (T)\nModify Memory Value (U)\nReset PSW (Z)\nSet Breakpoint Value (Y)\nHide Menu Prompt (H)\n"
-           "Stop Execution on Clock (X)\nQuit (Q)\n");
+           "Stop Execution on Clock (X)\nPrint Statistics (I)\nExport Statistics as JSON (J)\nBranch Profile (B)\n"
+           "Select Branch Predictor (K)\nPipeline Model Report (C)\nAdd Pipeline Model (O)\nSampled Simulation (F)\nLockstep Sweep (W)\nGDB Server (D)\n"
+           "Run in Background (A)\nExport Memory (E)\nMemory Diff (N)\nCoverage (V)\nCall Graph Profile (1)\nSampling Profile (2)\nCache Simulation (3)\nD-Memory Access Profile (4)\nPerformance Counters (5)\nIdle Fast-Forward (6)\nQuit (Q)\n");
+}
+
+/*
+ * @brief discards the rest of the input line, stopping at the end of the input so scripts cannot loop forever
+ */
+static void clear_input_line(void)
+{
+    int character;
+    do
+    {
+        character = getchar();
+    } while (character != '\n' && character != EOF);
 }
 
 /*
@@ -233,8 +369,14 @@ void menu(Emulator *emulator) {
         if(!emulator->hide_menu_prompt) printf("Enter Option (? for list of commands): ");
         if (scanf(" %c", &command) != 1)
         {
+            //the end of a script or of piped input quits like Q
+            if (feof(stdin))
+            {
+                command = 'q';
+                break;
+            }
             //clearing the input buffer
-            while (getchar() != '\n');
+            clear_input_line();
             continue;
         }
         command = (char) tolower(command);
@@ -249,6 +391,7 @@ void menu(Emulator *emulator) {
                 printf("Enter name of file to load:");
                 scanf("%70s", input_string);
                 load(input_file, input_string, emulator);
+                load_listing_symbols(emulator, input_string);
                 emulator->is_memset = true;
                 break;
             case 'm':
@@ -261,32 +404,21 @@ void menu(Emulator *emulator) {
                     printf("No file loaded, cannot run emulator\n");
                     break;
                 }
-                    //if it's single_step and the emulator has started we just want to move to the next clock cycle
-                else if(emulator->has_started && emulator->is_single_step)
-                {
-                    return;
-                }
-                    //if the loop was interrupted and is now resuming print a message reflecting that
-                    //reset user_interrupt variable
-                else if (emulator->has_started && emulator->is_user_interrupt)
+                //if the loop was interrupted and is now resuming print a message reflecting that
+                //reset user_interrupt variable
+                if (emulator->has_started && emulator->is_user_interrupt)
                 {
                     printf("Resuming emulation\n");
                     emulator->is_user_interrupt = false;
-                    return;
                 }
-                    //if the emulator has started and isn't in single step mode, we don't want to start it again
-                else if(emulator->has_started)
-                {
-                    printf("Emulator is already running\n");
-                    return;
-                }
-                    //if the emulator hasn't started, we can start it
-                else
+                else if (!emulator->has_started)
                 {
                     printf("Running Emulator\n");
-                    run_emulator(emulator);
-                    break;
                 }
+                //single step returns after every step, the menu is shown again in this loop rather than from inside
+                //the run
+                report_stop(emulator, run_emulator(emulator, 0));
+                break;
             case 's':
                 //toggle single step
                 emulator->is_single_step ? printf("[disabling]") : printf("[enabling]");
@@ -319,6 +451,63 @@ void menu(Emulator *emulator) {
             case '?':
                 print_menu_options();
                 break;
+            case 'i':
+                print_statistics(emulator);
+                break;
+            case 'j':
+                export_statistics(emulator);
+                break;
+            case 'b':
+                print_branch_profile(emulator);
+                break;
+            case 'k':
+                select_predictor(emulator);
+                break;
+            case 'c':
+                print_pipeline_models(emulator);
+                break;
+            case 'o':
+                configure_pipeline_models(emulator);
+                break;
+            case 'f':
+                configure_sampling(emulator);
+                break;
+            case 'w':
+                lockstep_sweep(emulator);
+                break;
+            case 'd':
+                gdb_server_menu(emulator);
+                break;
+            case 'a':
+                background_console(emulator);
+                break;
+            case 'e':
+                export_memory_menu(emulator);
+                break;
+            case 'n':
+                memory_diff_menu(emulator);
+                break;
+            case 'v':
+                coverage_menu(emulator);
+                break;
+            case '1':
+                call_profile_menu(emulator);
+                break;
+            case '2':
+                sampler_menu(emulator);
+                break;
+            case '3':
+                cache_menu(emulator);
+                break;
+            case '4':
+                access_profile_menu(emulator);
+                break;
+            case '5':
+                perf_counter_menu(emulator);
+                break;
+            case '6':
+                idle_menu(emulator);
+                break;
             case 'z':
                 printf("Clearing PSW\n");
                 memset(&emulator->psw, 0, sizeof(program_status_word));
@@ -327,13 +516,12 @@ void menu(Emulator *emulator) {
                 printf("Invalid command, try again\n");
                 break;
         }
-        while (getchar() != '\n'); //another buffer clear to ensure menu doesn't loop
+        clear_input_line(); //another buffer clear to ensure menu doesn't loop
     }
     while (tolower(command) != 'q');
     if(emulator->has_started)
     {
-        printf("Exiting Emulator...");
-        getchar();
-        exit(0);
+        print_statistics(emulator);
+        printf("Exiting Emulator...\n");
     }
 }
\ No newline at end of file
@@ -5,6 +5,10 @@
 #ifndef ASSIGNMENT1_DECODER_H
 #define ASSIGNMENT1_DECODER_H
 #include "loader.h"
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 
 #define REGISTER 0
 #define CONSTANT 1
@@ -163,6 +167,19 @@ typedef struct program_status_word_bits
     unsigned short previous_prio :3;
 }program_status_word_bits;
 
+//PSW flag positions, used by the ALU kernels to return and apply flags as a mask
+#define PSW_C_SHIFT 0
+#define PSW_Z_SHIFT 1
+#define PSW_N_SHIFT 2
+#define PSW_S_SHIFT 3
+#define PSW_V_SHIFT 4
+#define PSW_C (1 << PSW_C_SHIFT)
+#define PSW_Z (1 << PSW_Z_SHIFT)
+#define PSW_N (1 << PSW_N_SHIFT)
+#define PSW_V (1 << PSW_V_SHIFT)
+#define PSW_S (1 << PSW_S_SHIFT)
+#define PSW_NZCV (PSW_N | PSW_Z | PSW_C | PSW_V)
+
 typedef union program_status_word {
     unsigned short word;
     struct program_status_word_bits bits;
@@ -182,12 +199,286 @@ typedef struct hazard_control {
     bool d_bubble;
     bool e_bubble;
 }HazardControl;
+typedef struct pipeline_statistics
+{
+    unsigned long int clocks; //clock ticks spent in the pipeline
+    unsigned long int retired; //instructions that completed E0
+    unsigned long int decode_bubbles;
+    unsigned long int execute_bubbles;
+    unsigned long int taken_branches;
+    unsigned long int loads;
+    unsigned long int stores;
+    unsigned long int invalid_instructions;
+}PipelineStatistics;
+//each taken branch flushes the pipeline, costing one D0 and one E0 bubble
+#define FLUSH_PENALTY 2
+//in E0 the PC is two words past the executing instruction, branch offsets are decoded relative to that
+#define EXECUTE_PC_OFFSET 4
+
+typedef enum
+{
+    PREDICT_NOT_TAKEN = 0, //static not taken, the original pipeline behaviour
+    PREDICT_BTFN = 1, //backward taken, forward not taken
+    PREDICT_ONE_BIT = 2,
+    PREDICT_TWO_BIT = 3,
+    PREDICTOR_COUNT = 4
+}PREDICTOR_TYPES;
+
+#define BTB_ENTRIES 64 //direct mapped on the branch word address
+#define COUNTER_TABLE_SIZE 1024
+typedef struct btb_entry
+{
+    unsigned short tag; //full branch address
+    unsigned short target;
+    bool valid;
+}BTBEntry;
+typedef struct branch_predictor
+{
+    PREDICTOR_TYPES type;
+    BTBEntry btb[BTB_ENTRIES];
+    unsigned char counters[COUNTER_TABLE_SIZE]; //1-bit or 2-bit saturating counters
+    unsigned long int resolved; //branches resolved in E0
+    unsigned long int mispredicted; //branches that flushed the pipeline
+    long int cycles_saved; //bubble cycles avoided compared to static not taken
+}BranchPredictor;
+
+typedef enum
+{
+    STALL_DATA = 0, //read after write without a forwarding path in time
+    STALL_LOAD_USE = 1,
+    STALL_CONTROL = 2, //fetch slots lost after a branch or PC write
+    STALL_CAUSES = 3
+}STALL_CAUSE;
+
+#define MAX_PIPELINE_MODELS 8
+typedef struct pipeline_config
+{
+    unsigned char depth; //2, 3 or 5 stages
+    bool forwarding;
+    bool load_use_interlock; //stall on load-use, otherwise count the hazard and let it through
+}PipelineConfig;
+typedef struct pipeline_model
+{
+    PipelineConfig config;
+    unsigned long int instructions;
+    unsigned long int last_start; //cycle the previous instruction entered fetch
+    unsigned long int reg_ready[REGFILE_SIZE]; //first cycle a consumer can have the register in E
+    unsigned long int reg_ready_no_load[REGFILE_SIZE]; //same, ignoring the extra load latency
+    bool reg_from_load[REGFILE_SIZE];
+    unsigned long int stalls[STALL_CAUSES];
+    unsigned long int unprotected_load_use;
+    unsigned short last_address;
+}PipelineModel;
+
+#define PERF_COUNTER_BASE 0xFFC0 //the device takes the top 64 bytes of D-memory while mapped
+typedef enum
+{
+    PERF_CLOCK = 0,
+    PERF_RETIRED = 1,
+    PERF_BUBBLES = 2,
+    PERF_COUNTERS = 3
+}PERF_COUNTER_IDS;
+typedef struct perf_counter_device
+{
+    bool mapped;
+    uint64_t snapshot[PERF_COUNTERS]; //counters as they were at the last write to LATCH
+    unsigned long int latches;
+}PerfCounterDevice;
+
+#define ACCESS_LINE_SHIFT 4 //lines of 16 bytes
+#define ACCESS_LINES ((BYTE_MEMORY_SIZE) >> ACCESS_LINE_SHIFT)
+#define REUSE_BUCKETS 13 //distance 0, then 1, 2-3, 4-7 ... 2048-4095, the most other lines there are
+#define REUSE_POSITIONS (1 << 16) //accesses the reuse tree holds before it is renumbered
+typedef struct access_site
+{
+    unsigned long int accesses;
+    unsigned long int constant; //accesses whose stride matched the one before
+    unsigned short last_address;
+    short stride; //address change between the last two accesses
+    OPCODES opcode;
+    operands mode; //addressing mode of the last access, inc, dec and pre/post
+}AccessSite;
+typedef struct access_profile
+{
+    unsigned int reads[ACCESS_LINES];
+    unsigned int writes[ACCESS_LINES];
+    AccessSite *sites; //one per I-memory word, indexed by the LD/ST address >> 1
+    unsigned int last_use[ACCESS_LINES]; //position of each line's last access, 0 if never accessed
+    unsigned short line_at[REUSE_POSITIONS + 1]; //line accessed at each position
+    unsigned int reuse_tree[REUSE_POSITIONS + 1]; //Fenwick tree, 1 at the position of each line's last access
+    unsigned int position;
+    unsigned long int reuse[REUSE_BUCKETS];
+    unsigned long int cold; //first accesses, no reuse distance
+    unsigned long int accesses;
+}AccessProfile;
+
+#define CACHE_TYPES 2 //indexed by I_MEMORY and D_MEMORY
+typedef enum
+{
+    CACHE_WRITE_BACK = 0, //allocate on a write miss, dirty lines written when evicted
+    CACHE_WRITE_THROUGH = 1 //no allocate on a write miss, every write goes to memory
+}CACHE_WRITE_POLICIES;
+typedef struct cache_config
+{
+    unsigned int size; //bytes of data, not counting tags
+    unsigned char ways;
+    unsigned short line_size; //bytes
+    CACHE_WRITE_POLICIES write_policy;
+    unsigned int miss_penalty; //cycles to fill or write back a line
+}CacheConfig;
+typedef struct cache_model
+{
+    CacheConfig config;
+    unsigned short *ways; //set after set, each set in most recently used order
+    unsigned short set_mask;
+    unsigned char line_shift;
+    unsigned long int reads;
+    unsigned long int writes;
+    unsigned long int read_misses;
+    unsigned long int write_misses;
+    unsigned long int writebacks; //dirty lines evicted
+    unsigned long int memory_writes; //writes sent straight to memory by a write through cache
+    unsigned long int stall_cycles;
+}CacheModel;
+
+typedef struct branch_site
+{
+    unsigned long int executions;
+    unsigned long int taken;
+    unsigned long int bubble_cycles;
+    short opcode;
+}BranchSite;
+
+#define COVERAGE_BITMAP_WORDS ((WORD_MEMORY_SIZE) / 64) //4 KB, one bit per I-memory word
+typedef struct coverage_bitmap
+{
+    uint64_t bits[COVERAGE_BITMAP_WORDS];
+}CoverageBitmap;
+#define MAX_SYMBOL_LEN 32
+typedef struct symbol
+{
+    unsigned short address;
+    char name[MAX_SYMBOL_LEN];
+}Symbol;
+typedef struct symbol_table
+{
+    Symbol *symbols; //sorted by address
+    int *by_name; //indexes into symbols sorted by name
+    int count;
+    int last_found; //index of the label found last, checked before searching
+}SymbolTable;
+
+#define CALL_STACK_DEPTH 256 //frames the call profiler follows, deeper calls are charged to the deepest
+#define MAX_CALL_NODES 4096 //distinct call paths, calls on new paths past this are charged to the caller
+typedef struct call_node
+{
+    unsigned short function; //entry address
+    int parent;
+    int first_child;
+    int next_sibling;
+    unsigned long int calls;
+    unsigned long int self_clocks; //clocks spent in this function on this path, not in its callees
+}CallNode;
+typedef struct call_frame
+{
+    int node;
+    unsigned short return_address; //the LR the call was made with
+}CallFrame;
+#define MAX_UNTRACKED_RETURNS 16 //distinct return addresses kept for calls past CALL_STACK_DEPTH
+typedef struct untracked_return
+{
+    unsigned short return_address;
+    unsigned long int count; //untracked calls still waiting to come back here
+}UntrackedReturn;
+typedef struct call_profile
+{
+    CallNode nodes[MAX_CALL_NODES]; //calling context tree, node 0 is the code running when profiling began
+    int node_count;
+    CallFrame stack[CALL_STACK_DEPTH];
+    int depth;
+    unsigned long int untracked_depth; //calls made past CALL_STACK_DEPTH that have not returned
+    UntrackedReturn untracked[MAX_UNTRACKED_RETURNS]; //where those calls return, keyed by return address
+    int untracked_count;
+    unsigned long int last_clock; //clock of the last call or return
+    unsigned long int truncated_calls;
+    unsigned long int unwound_frames; //frames popped by a return to a frame beneath them
+}CallProfile;
+
+#define SAMPLE_BUFFER_SIZE (1 << 14) //a power of two
+#define MICROSECONDS_PER_SECOND 1000000
+typedef enum
+{
+    SAMPLE_HOST_TIMER = 0, //SIGPROF from setitimer, period in microseconds of host CPU time
+    SAMPLE_CLOCK_COUNT = 1 //from the run loop, period in guest clocks
+}SAMPLE_TRIGGERS;
+typedef struct pc_sample
+{
+    unsigned short pc; //the instruction E0 executed last
+    unsigned short lr;
+}PcSample;
+typedef struct sample_profile
+{
+    SAMPLE_TRIGGERS trigger;
+    unsigned long int period;
+    unsigned long int next_check_clock; //the run loop calls sample_clock when the clock reaches this
+    unsigned long int next_drain_clock;
+    PcSample buffer[SAMPLE_BUFFER_SIZE];
+    _Atomic unsigned int head; //advanced by the sampler
+    _Atomic unsigned int tail; //advanced by the drain
+    _Atomic unsigned long int dropped; //samples lost to a full ring
+    unsigned int *pc_counts; //drained samples per I-memory word
+    unsigned int *lr_counts;
+    unsigned long int samples;
+}SampleProfile;
+
+#define RECORD_COVERAGE(emulator, address) \
+    ((emulator)->coverage->bits[(address) >> 7] |= (uint64_t)1 << (((address) >> 1) & 63))
+
+typedef enum
+{
+    FAST_FORWARD_OFF = 0,
+    FAST_FORWARD_TO_PC = 1, //until the next instruction to execute is at the target address
+    FAST_FORWARD_TO_CLOCK = 2, //until the clock reaches the target
+    FAST_FORWARD_INSTRUCTIONS = 3 //for the target number of instructions
+}FAST_FORWARD_MODES;
+
+typedef struct sampling_config
+{
+    FAST_FORWARD_MODES mode;
+    unsigned long int target; //PC, clock or instruction count that ends the first fast-forward
+    unsigned long int window_clocks; //length of each detailed window, 0 runs detailed to the end
+    unsigned long int period_instructions; //instructions fast-forwarded between windows, 0 for a single window
+    unsigned long int window_start; //clock the current detailed window began
+    unsigned long int fast_forwarded; //instructions executed functionally
+    unsigned long int windows; //detailed windows started
+}SamplingConfig;
 
 #define EXTRACT_BITS(num_bits, start, val) ((((1 << num_bits) - 1) << start) & val)
 
 
 #define REG_FILE_OPTIONS 2 //register or constant
 #define REGFILE_SIZE 8
+typedef struct idle_lap //what the run loop looks at each time a branch to itself comes around
+{
+    unsigned long int clock;
+    PipelineStatistics stats;
+    BranchPredictor predictor;
+    BranchSite site;
+    HazardControl hazard_control;
+    unsigned short program_counter;
+    unsigned short fetch_address;
+    unsigned short instruction_register;
+}IdleLap;
+typedef struct idle_state
+{
+    bool skip_loops; //run branches to themselves up to the next event instead of halting
+    bool asleep; //the sleep bit stopped the core, cleared on the even clock after it wakes
+    unsigned short loop_address;
+    unsigned char loop_laps; //0 until a branch to itself is seen in this run
+    IdleLap last; //the loop as it was last time around
+    unsigned long int idle_clocks; //clocks asleep or skipped in idle loops
+}IdleState;
+
 typedef struct emulator_data
 {
     OPCODES opcode; //opcode of instruction, instructions are 16 bits so this can hold any possible opcode
@@ -199,31 +490,65 @@ typedef struct emulator_data
     InstControlRegisters i_control; //registers to emulate xm23p behaviour
     DataControlRegisters d_control;//registers to emulate xm23p behaviour
     HazardControl hazard_control;
+    PipelineStatistics stats;
+    BranchSite *branch_profile; //one entry per I-memory word, indexed by branch address >> 1
+    CoverageBitmap *coverage; //words executed, NULL while coverage is off
+    SymbolTable *symbols; //labels from the program's .lis listing, NULL if there is none
+    CallProfile *call_profile; //shadow call stack, NULL while call profiling is off
+    SampleProfile *sample_profile; //NULL while sampling is off
+    CacheModel *caches[CACHE_TYPES]; //I-cache and D-cache models, NULL when not simulated
+    AccessProfile *access_profile; //D-memory access patterns, NULL while access profiling is off
+    PerfCounterDevice perf_counters;
+    IdleState idle;
+    BranchPredictor predictor;
+    PipelineModel pipeline_models[MAX_PIPELINE_MODELS];
+    unsigned char pipeline_model_count;
+    SamplingConfig sampling;
     bool is_memset; //bool to check if a file has been loaded
     bool has_started; //bool to check if the emulator has started
     bool is_single_step; //bool to check if the emulator will run in single step mode or continuous
     bool is_user_interrupt; //bool to check if the user has interrupted the emulator via a SIGINT
     bool hide_menu_prompt;
     bool stop_on_clock;
+    bool is_quiet; //bool to skip the pipeline trace and loader progress messages
     short offset;
     MEMORY_ACCESS_TYPES xCTRL;
     unsigned short instruction_register;
+    unsigned short decode_address; //address of the instruction in D0
+    unsigned short execute_address; //address of the instruction in E0
+    unsigned short previously_decoded; //instruction word from D0, printed by the trace when it reaches E0
+    bool decoded_invalid; //D0 did not recognise the word, E0 runs the stale opcode again but does not retire it
     unsigned char move_byte;
     unsigned long int clock;
+    unsigned long int clock_limit; //stop emulation when the clock reaches this value, 0 for no limit
     unsigned int starting_address;
     unsigned int breakpoint;
 }Emulator;
+
+//why run_emulator returned, it resumes from the same point when called again
+typedef enum
+{
+    STOP_BREAKPOINT = 0,
+    STOP_STEP = 1, //single step mode, after every clock or every instruction
+    STOP_INTERRUPT = 2, //ctrl-c
+    STOP_HALT = 3, //branched to itself, the run is over
+    STOP_CLOCK_LIMIT = 4, //the emulator's clock_limit, the run is over
+    STOP_CLOCK_BUDGET = 5, //the clocks passed to run_emulator
+    STOP_WINDOW_END = 6 //the last sampled simulation window ended, the run is over
+}StopReason;
 void menu(Emulator *emulator);
 void init_emulator(Emulator *emulator);
 void print_psw(Emulator *emulator, int style);
 void print_menu_options();
 void execute_branch(Emulator *emulator);
+bool branch_condition(Emulator *emulator);
 
 //decoding
 void print_registers(Emulator *emulator);
 void modify_registers(Emulator *emulator);
 void modify_memory_locations(Emulator *emulator);
 void set_breakpoint(Emulator *emulator);
+void set_breakpoint_address(Emulator *emulator, int temp_breakpoint);
 void decode_instruction(Emulator *emulator);
 void parse_arithmetic_block(Emulator *emulator, instruction_data current_instruction, short starting_addr);
 void parse_reg_manip_block(Emulator *emulator, instruction_data current_instruction, short starting_addr);
@@ -237,14 +562,15 @@ void parse_branch_block(Emulator *emulator, instruction_data data);
 
 
 //executions
-void
-update_psw(unsigned short result, Emulator *emulator, unsigned short old_dest, unsigned short source);
 void execute_1(Emulator *emulator);
 void execute_0(Emulator *emulator);
+bool execute_instruction(Emulator *emulator);
 void fetch_instruction(Emulator *emulator, int even);
 void memory_controller(Emulator *emulator);
-void run_emulator(Emulator *emulator);
-void bcd_addition(Emulator *emulator);
+StopReason run_emulator(Emulator *emulator, unsigned long int clock_budget);
+void report_stop(Emulator *emulator, StopReason reason);
+void int_handler(int signum);
+void pipeline_clock(Emulator *emulator);
 short calc_index_adjustment(Emulator *emulator);
 
 void execute_arithmetic(Emulator *emulator);
@@ -253,8 +579,294 @@ void execute_load_store(Emulator *emulator);
 void execute_reg_manip(Emulator *emulator);
 void execute_mov_swap(Emulator *emulator);
 
+//alu kernels
+#define ALU_OPCODES (bis - add + 1)
+//a kernel result, the 16 bit result in the low half and the PSW flags it sets in the high half
+#define ALU_OUT(result, flags) ((unsigned int)(flags) << 16 | (unsigned short)(result))
+#define ALU_RESULT(out) ((unsigned short)(out))
+#define ALU_FLAGS(out) ((out) >> 16)
+typedef unsigned int (*AluKernel)(unsigned short dest, unsigned short source, unsigned char carry);
+extern const AluKernel alu_kernels[2][ALU_OPCODES];
+extern const unsigned char alu_flag_masks[ALU_OPCODES];
+void init_alu_tables(void);
+unsigned int alu_dadd(unsigned short dest, unsigned short source, unsigned char wb, unsigned char carry);
+
+//statistics
+void print_statistics(Emulator *emulator);
+void write_statistics_json(Emulator *emulator, FILE *out);
+void export_statistics(Emulator *emulator);
+void record_branch(Emulator *emulator, bool taken, bool flushed);
+void print_branch_profile(Emulator *emulator);
+
+//branch prediction
+unsigned short predict_next_fetch(Emulator *emulator, unsigned short fetch_address);
+bool redirect_fetch(Emulator *emulator, bool *taken);
+void resolve_branch(Emulator *emulator);
+void select_predictor(Emulator *emulator);
+const char *predictor_name(PREDICTOR_TYPES type);
+
+//pipeline models
+void register_usage(Emulator *emulator, unsigned char *reads, unsigned char *writes);
+bool add_pipeline_model(Emulator *emulator, PipelineConfig config);
+void model_instruction(Emulator *emulator);
+void configure_pipeline_models(Emulator *emulator);
+void print_pipeline_models(Emulator *emulator);
+void write_pipeline_models_json(Emulator *emulator, FILE *out);
+
+//sampled simulation
+bool functional_step(Emulator *emulator);
+unsigned short next_execute_address(Emulator *emulator);
+void settle_pipeline(Emulator *emulator);
+void redirect_execution(Emulator *emulator, unsigned short address);
+bool branched_to_self(Emulator *emulator);
+void fast_forward(Emulator *emulator, FAST_FORWARD_MODES mode, unsigned long int target);
+bool sample_window_elapsed(Emulator *emulator);
+void configure_sampling(Emulator *emulator);
+
+//symbol table
+bool parse_listing_word(const char *line, unsigned int *address, int *source_start);
+SymbolTable *load_symbols(const char *listing_path);
+void free_symbols(SymbolTable *table);
+const Symbol *find_symbol(SymbolTable *table, unsigned short address);
+bool find_symbol_address(const SymbolTable *table, const char *name, unsigned short *address);
+const char *symbol_suffix(Emulator *emulator, unsigned short address);
+bool parse_code_address(Emulator *emulator, const char *text, int *address);
+bool load_listing_symbols(Emulator *emulator, const char *xme_path);
+
+//call graph profile
+bool enable_call_profile(Emulator *emulator);
+void disable_call_profile(Emulator *emulator);
+void profile_calls(Emulator *emulator, bool pc_written);
+void profile_load_return(Emulator *emulator);
+void print_call_profile(Emulator *emulator);
+void write_folded_stacks(Emulator *emulator, FILE *out);
+void call_profile_menu(Emulator *emulator);
+
+//idle fast-forward
+bool sleep_until_event(Emulator *emulator, unsigned long int budget_end);
+bool skip_idle_loop(Emulator *emulator, unsigned long int budget_end);
+bool sleep_until_clock(Emulator *emulator, unsigned long int end);
+void idle_menu(Emulator *emulator);
+
+//performance counter device
+void perf_counter_access(Emulator *emulator);
+void latch_perf_counters(Emulator *emulator);
+void print_perf_counters(Emulator *emulator);
+void perf_counter_menu(Emulator *emulator);
+
+//D-memory access profile
+bool enable_access_profile(Emulator *emulator);
+void disable_access_profile(Emulator *emulator);
+void profile_access(Emulator *emulator);
+void print_access_profile(Emulator *emulator);
+void access_profile_menu(Emulator *emulator);
+
+//cache simulation
+bool add_cache(Emulator *emulator, int mem_type, CacheConfig config);
+void remove_cache(Emulator *emulator, int mem_type);
+void cache_access(CacheModel *cache, unsigned short address, bool is_write);
+bool parse_cache_config(const char *text, CacheConfig *config);
+void print_cache_report(Emulator *emulator);
+void write_caches_json(Emulator *emulator, FILE *out);
+void cache_menu(Emulator *emulator);
+
+//sampling profiler
+bool enable_sampler(Emulator *emulator, SAMPLE_TRIGGERS trigger, unsigned long int period);
+void disable_sampler(Emulator *emulator);
+void sample_clock(Emulator *emulator);
+void print_sample_report(Emulator *emulator);
+void sampler_menu(Emulator *emulator);
+
+//instruction coverage
+bool enable_coverage(Emulator *emulator);
+void disable_coverage(Emulator *emulator);
+void merge_coverage(CoverageBitmap *into, const CoverageBitmap *from);
+bool load_coverage(CoverageBitmap *coverage, const char *path);
+bool accumulate_coverage(CoverageBitmap *coverage, const char *path);
+void print_coverage_report(Emulator *emulator, const char *listing_path);
+void coverage_menu(Emulator *emulator);
+
+//memory export
+typedef enum
+{
+    EXPORT_HEX_DUMP = 0, //the layout display_loader_memory prints
+    EXPORT_RAW = 1,
+    EXPORT_S_RECORDS = 2 //S1 or S2 records and an S9 the loader can read back
+}EXPORT_FORMATS;
+bool export_memory(int fd, int mem_type, int lower, int upper, EXPORT_FORMATS format, unsigned short start_address);
+void export_memory_menu(Emulator *emulator);
+
+//memory diff
+#define DIFF_MERGE_GAP 8 //differing bytes closer than this are reported as one range
+#define DIFF_SHOW_BYTES 16 //bytes of each range printed before and after
+typedef struct diff_range
+{
+    int start;
+    int end; //one past the last differing byte
+    int changed; //bytes in the range that differ
+}DiffRange;
+int diff_memory(const unsigned char *before, const unsigned char *after, int length, DiffRange *ranges,
+                int max_ranges);
+int print_memory_diff(char bank, const unsigned char *before, const unsigned char *after, int length);
+int read_memory_image(const char *path, Memory *bank);
+int diff_memory_image(int mem_type, const char *path);
+void memory_diff_menu(Emulator *emulator);
+
+//gdb remote stub
+#define GDB_DATA_MEMORY_BASE 0x10000 //D-memory address 0 as the debugger sees it, I-memory starts at 0
+int run_gdb_server(Emulator *emulator, const char *address);
+void gdb_server_menu(Emulator *emulator);
+
+//background emulation
+#define BACKGROUND_QUEUE_SIZE 64 //a power of two
+#define BACKGROUND_BATCH_CLOCKS (1 << 14) //clocks between looks at the command queue
+typedef enum
+{
+    BACKGROUND_PAUSE = 0,
+    BACKGROUND_RESUME = 1,
+    BACKGROUND_SET_BREAKPOINT = 2,
+    BACKGROUND_QUIT = 3 //stops the thread, the run can be resumed from the menu
+}BACKGROUND_COMMANDS;
+typedef struct background_command
+{
+    BACKGROUND_COMMANDS type;
+    unsigned short address;
+}BackgroundCommand;
+typedef struct emulator_snapshot
+{
+    unsigned short registers[REGFILE_SIZE];
+    unsigned short psw;
+    unsigned long int clock;
+    unsigned long int retired;
+    unsigned int breakpoint;
+    StopReason reason; //why the run last stopped
+    bool paused;
+    bool ended; //the run is over
+}EmulatorSnapshot;
+typedef struct background_emulation
+{
+    Emulator *emulator; //only touched by the emulator thread while it runs
+    pthread_t thread;
+    BackgroundCommand commands[BACKGROUND_QUEUE_SIZE];
+    _Atomic unsigned int command_head; //next command the emulator thread takes
+    _Atomic unsigned int command_tail; //next free slot for the front end
+    _Atomic unsigned int snapshot_sequence; //odd while the snapshot is being written
+    EmulatorSnapshot snapshot;
+    bool was_quiet;
+}BackgroundEmulation;
+bool start_background(BackgroundEmulation *background, Emulator *emulator);
+bool send_background_command(BackgroundEmulation *background, BACKGROUND_COMMANDS type, unsigned short address);
+void read_snapshot(BackgroundEmulation *background, EmulatorSnapshot *out);
+void stop_background(BackgroundEmulation *background);
+void background_console(Emulator *emulator);
+
+//binary control protocol
+//a request is a little-endian u32 length, the command byte and its payload, a response is a u32 length, the status
+//byte and its payload, the lengths count the bytes after themselves
+#define CONTROL_MAX_REQUEST (1 << 17) //large enough to write a whole memory in one request
+#define CONTROL_NO_STOP (-1)
+typedef enum
+{
+    CONTROL_LOAD = 1, //path of an .xme file, resets the session first
+    CONTROL_RESET = 2, //clears the emulator and both memories
+    CONTROL_READ_MEMORY = 3, //u8 I_MEMORY or D_MEMORY, u16 address, u32 length -> the bytes
+    CONTROL_WRITE_MEMORY = 4, //u8 I_MEMORY or D_MEMORY, u16 address, the bytes
+    CONTROL_RUN = 5, //u64 clocks (0 for no limit), i32 stop address or CONTROL_NO_STOP -> u8 stop reason, u64 clock
+    CONTROL_READ_STATE = 6, //-> R0-R6, PC, PSW as u16, u64 clock, the PC is the next instruction to execute
+    CONTROL_WRITE_REGISTER = 7 //u8 register (0-6, 7 for the PC, 8 for the PSW), u16 value
+}CONTROL_COMMANDS;
+typedef enum
+{
+    CONTROL_OK = 0,
+    CONTROL_BAD_REQUEST = 1,
+    CONTROL_LOAD_FAILED = 2
+}CONTROL_STATUS;
+typedef enum
+{
+    CONTROL_STOP_CLOCKS = 0, //ran the requested clocks
+    CONTROL_STOP_ADDRESS = 1, //the next instruction is at the stop address
+    CONTROL_STOP_HALTED = 2 //branched to itself, or asleep with nothing to wake it
+}CONTROL_STOP_REASONS;
+int run_control_server(const char *path);
+
+//paged memory
+#define PAGE_SHIFT 8
+#define PAGE_SIZE (1 << PAGE_SHIFT) //256 bytes
+#define PAGE_COUNT ((BYTE_MEMORY_SIZE) >> PAGE_SHIFT)
+typedef struct page_image
+{
+    unsigned char *pages[PAGE_COUNT]; //read-only, shared by every instance made from the image
+    unsigned char *storage; //the zero page followed by the pages that are not all zeros
+    unsigned int stored_pages; //pages that are not all zeros
+}PageImage;
+typedef struct paged_memory
+{
+    unsigned char *pages[PAGE_COUNT]; //the image's page until the first write, then a private copy
+    const PageImage *image;
+    unsigned int copied_pages;
+}PagedMemory;
+PageImage *create_page_image(const Memory *memory);
+void free_page_image(PageImage *image);
+void init_paged_memory(PagedMemory *memory, const PageImage *image);
+void free_paged_memory(PagedMemory *memory);
+unsigned short paged_read_word(const PagedMemory *memory, unsigned short address);
+unsigned char paged_read_byte(const PagedMemory *memory, unsigned short address);
+void paged_write_word(PagedMemory *memory, unsigned short address, unsigned short value);
+void paged_write_byte(PagedMemory *memory, unsigned short address, unsigned char value);
+void read_paged_memory(const PagedMemory *memory, Memory *out);
+
+//lockstep multi-instance
+#define LOCKSTEP_VECTOR_LANES 16 //16 bit lanes in one AVX2 register
+#define LOCKSTEP_DIVERGENCE_LIMIT 256 //steps a lane may wait at another address before it is finished on its own
+#define LOCKSTEP_NO_STOP (-1)
+typedef enum
+{
+    LANE_RUNNING = 0,
+    LANE_HALTED = 1, //branched to itself, reached the stop address or the instruction limit
+    LANE_EVICTED = 2 //diverged from the group for too long, finished by the scalar path
+}LANE_STATES;
+typedef struct lane_decode
+{
+    OPCODES opcode;
+    short operand_bits;
+    operands inst_operands;
+    short offset;
+    unsigned char move_byte;
+}LaneDecode;
+typedef struct lockstep_group
+{
+    unsigned int lanes;
+    unsigned int padded_lanes; //rows are padded to whole vectors, the padding lanes never run
+    unsigned short *reg_file[REGFILE_SIZE]; //reg_file[register][lane], R7 holds the fetch address
+    unsigned short *psw;
+    unsigned short *execute_address; //address of the next instruction each lane executes
+    unsigned short *cpu_ops; //CC bits of the lane's last CPU instruction, MOVL..MOVH OR them into the PSW
+    unsigned short *last_word; //last word that set the opcode, decoded again before words that leave it stale
+    unsigned short *waited; //group steps spent waiting at another address
+    unsigned short *running; //0xFFFF while the lane runs in lockstep
+    unsigned int *instructions;
+    unsigned int *bubbles;
+    unsigned int *snapshot_at; //instruction count when snapshots was saved
+    LaneDecode *snapshots; //decode state after a word that left the opcode stale
+    unsigned char *state;
+    PagedMemory *data_memory; //one copy on write D-memory per lane, I-memory is shared
+    PageImage *data_image; //the loaded D-memory the lanes share until they write to it
+    Emulator *scratch; //decodes for the group and runs the scalar path
+    int stop_address; //lanes halt before executing this address, LOCKSTEP_NO_STOP to run to a branch to itself
+    unsigned long int instruction_limit; //0 for no limit
+    unsigned long int group_steps;
+    unsigned long int vector_steps; //group steps that ran on AVX2
+    unsigned long int evictions;
+    bool use_avx2;
+}LockstepGroup;
+LockstepGroup *create_lockstep_group(unsigned int lanes, unsigned short start_address);
+void free_lockstep_group(LockstepGroup *group);
+void run_lockstep(LockstepGroup *group);
+void lockstep_sweep(Emulator *emulator);
+
 
 
 extern Memory loader_memory[2];
+extern volatile sig_atomic_t stop_loop;
 
 #endif //ASSIGNMENT1_DECODER_H
@@ -11,8 +11,6 @@
 #define WORD 0
 #define BYTE 1
 
-unsigned char carry_check[2][2][2] = {0, 0, 1, 0, 1, 0, 1, 1};
-unsigned char overflow_check[2][2][2] = {0, 1, 0, 0, 0, 0, 1, 0};
 
 
 /*
@@ -24,15 +22,76 @@ void execute_1(Emulator *emulator) {
     if (emulator->opcode == ld || emulator->opcode == ldr)
     {
         emulator->reg_file[REGISTER][emulator->inst_operands.dest].word = emulator->d_control.DMBR;
+        if (emulator->call_profile != NULL && emulator->inst_operands.dest == PROG_COUNTER)
+        {
+            profile_load_return(emulator);
+        }
     }
 }
 
 /*
- * @brief This function calls an execution function based on a given opcodes position within a group
- * @note BEFORE REFACTORING OPCODE ORDERING, ENSURE IT DOES NOT AFFECT THE CASE RANGES
+ * @brief This function handles the E0 stage of pipeline execution, executing the decoded instruction and
+ * recording it in the statistics, coverage, call profile, branch profile and pipeline models. A word D0 could not
+ * decode is not counted as retired
  */
 void execute_0(Emulator *emulator) {
-    unsigned short prev_prog_counter = emulator->reg_file[REGISTER][PROG_COUNTER].word;
+    bool pc_written;
+    if (!emulator->decoded_invalid)
+    {
+        emulator->stats.retired++;
+    }
+    if (emulator->coverage != NULL)
+    {
+        RECORD_COVERAGE(emulator, emulator->execute_address);
+    }
+    if (emulator->pipeline_model_count)
+    {
+        model_instruction(emulator);
+    }
+    if (emulator->predictor.type != PREDICT_NOT_TAKEN && emulator->opcode <= bra)
+    {
+        //the predictor decides if the fetched path was right, so branches do not touch the PC directly
+        resolve_branch(emulator);
+        if (emulator->call_profile != NULL)
+        {
+            profile_calls(emulator, false);
+        }
+        return;
+    }
+    pc_written = execute_instruction(emulator);
+    if (emulator->call_profile != NULL)
+    {
+        profile_calls(emulator, pc_written);
+    }
+    if (emulator->opcode <= bra)
+    {
+        record_branch(emulator, pc_written, pc_written);
+    }
+    else if (emulator->opcode == ld || emulator->opcode == ldr)
+    {
+        emulator->stats.loads++;
+    }
+    else if (emulator->opcode == st || emulator->opcode == str)
+    {
+        emulator->stats.stores++;
+    }
+}
+
+/*
+ * @brief This function calls an execution function based on a given opcodes position within a group, and flushes
+ * the pipeline if the instruction wrote the PC
+ * @return true if the PC was written and the pipeline flushed
+ * @note BEFORE REFACTORING OPCODE ORDERING, ENSURE IT DOES NOT AFFECT THE CASE RANGES
+ */
+bool execute_instruction(Emulator *emulator) {
+    unsigned short fetch_prog_counter = emulator->reg_file[REGISTER][PROG_COUNTER].word;
+    unsigned short prev_prog_counter;
+    if (emulator->predictor.type != PREDICT_NOT_TAKEN)
+    {
+        //fetch may be running ahead on a predicted path, the instruction still sees the PC two words past itself
+        emulator->reg_file[REGISTER][PROG_COUNTER].word = emulator->execute_address + EXECUTE_PC_OFFSET;
+    }
+    prev_prog_counter = emulator->reg_file[REGISTER][PROG_COUNTER].word;
     switch (emulator->opcode)
     {
         // ... operator indicates a range of values, since opcodes are stored as an enum this allows the below syntax
@@ -61,64 +120,53 @@ void execute_0(Emulator *emulator) {
             printf("Invalid Opcode\n");
             break;
     }
-    if (prev_prog_counter != emulator->reg_file[REGISTER][PROG_COUNTER].word)
+    //a taken branch flushes even when its target is the address fetch had already reached, the word fetched in
+    //between is the instruction it skips
+    if (prev_prog_counter != emulator->reg_file[REGISTER][PROG_COUNTER].word ||
+        (emulator->opcode <= bra && branch_condition(emulator)))
     {
         emulator->hazard_control.e_bubble = true;
         emulator->hazard_control.d_bubble = true;
+        return true;
     }
+    //PC was not written, put back where fetch had got to
+    emulator->reg_file[REGISTER][PROG_COUNTER].word = fetch_prog_counter;
+    return false;
 }
 
-void execute_branch(Emulator *emulator) {
+/*
+ * @brief This function evaluates the condition of the branch in E0 against the PSW
+ * @return true if the branch is taken, BRA and BL are always taken
+ */
+bool branch_condition(Emulator *emulator) {
     switch (emulator->opcode)
     {
         case beq_bz:
-            if (emulator->psw.bits.zero)
-            {
-                emulator->reg_file[REGISTER][PROG_COUNTER].word += emulator->offset;
-            }
-            break;
+            return emulator->psw.bits.zero;
         case bne_bnz:
-            if (!emulator->psw.bits.zero)
-            {
-                emulator->reg_file[REGISTER][PROG_COUNTER].word += emulator->offset;
-            }
-            break;
+            return !emulator->psw.bits.zero;
         case bc_bhs:
-            if (emulator->psw.bits.carry)
-            {
-                emulator->reg_file[REGISTER][PROG_COUNTER].word += emulator->offset;
-            }
-            break;
+            return emulator->psw.bits.carry;
         case bnc_blo:
-            if (!emulator->psw.bits.carry)
-            {
-                emulator->reg_file[REGISTER][PROG_COUNTER].word += emulator->offset;
-            }
-            break;
+            return !emulator->psw.bits.carry;
         case bn:
-            if (emulator->psw.bits.negative)
-            {
-                emulator->reg_file[REGISTER][PROG_COUNTER].word += emulator->offset;
-            }
-            break;
+            return emulator->psw.bits.negative;
         case bge:
-            if (emulator->psw.bits.negative == emulator->psw.bits.overflow)
-            {
-                emulator->reg_file[REGISTER][PROG_COUNTER].word += emulator->offset;
-            }
-            break;
+            return emulator->psw.bits.negative == emulator->psw.bits.overflow;
         case blt:
-            if (emulator->psw.bits.negative != emulator->psw.bits.overflow)
-            {
-                emulator->reg_file[REGISTER][PROG_COUNTER].word += emulator->offset;
-            }
-            break;
+            return emulator->psw.bits.negative != emulator->psw.bits.overflow;
         case bra:
-            emulator->reg_file[REGISTER][PROG_COUNTER].word += emulator->offset;
-            break;
         case bl:
-            emulator->reg_file[REGISTER][PROG_COUNTER].word += emulator->offset;
-            break;
+            return true;
+        default:
+            return false;
+    }
+}
+
+void execute_branch(Emulator *emulator) {
+    if (branch_condition(emulator))
+    {
+        emulator->reg_file[REGISTER][PROG_COUNTER].word += emulator->offset;
     }
 }
 
@@ -335,218 +383,41 @@ void execute_chg_reg(Emulator *emulator) {
 }
 
 /*
- * @brief This function executes the arithmetic and logical instructions
- * such as add, addc, sub, subc, dadd, cmp, xor, and, or, bit, bic, and bis
- * These instructions all modify the PSW in one way or another
+ * @brief This function executes the arithmetic and logic instructions through the ALU kernels, which return the
+ * result and flags together so the PSW is updated with one mask
  */
 void execute_arithmetic(Emulator *emulator) {
-    unsigned short temp;
-    unsigned short old_dest;
-    unsigned short destination;
-    unsigned short source;
     unsigned char dest = emulator->inst_operands.dest;
     unsigned char wb = emulator->inst_operands.word_or_byte;
     unsigned char rc = emulator->inst_operands.register_or_constant;
     unsigned char sc = emulator->inst_operands.source_const;
+    unsigned char flag_mask = alu_flag_masks[emulator->opcode - add];
+    unsigned int out;
 
-    if (wb == WORD)
-    {
-        //destination before any operations
-        old_dest = emulator->reg_file[REGISTER][dest].word;
-        destination = emulator->reg_file[REGISTER][dest].word;
-        source = emulator->reg_file[rc][sc].word;
-    }
-    else
-    {
-        //destination before any operations
-        old_dest = emulator->reg_file[REGISTER][dest].byte[LSB];
-        destination = emulator->reg_file[REGISTER][dest].byte[LSB];
-        source = emulator->reg_file[rc][sc].byte[LSB];
-    }
-    switch (emulator->opcode)
-    {
-        case add:
-            destination += source;
-            update_psw(destination, emulator, old_dest, source);
-            break;
-        case addc: // add with carry
-            destination += source + emulator->psw.bits.carry;
-            update_psw(destination, emulator, old_dest, source);
-            break;
-        case sub:
-            destination += ~source + 1;
-            update_psw(destination, emulator, old_dest, ~source);
-            break;
-        case subc: // subtract with carry
-            destination += ~source + 1 + emulator->psw.bits.carry;
-            update_psw(destination, emulator, old_dest, ~source);
-            break;
-        case dadd: // decimal add
-            bcd_addition(emulator);
-            destination = emulator->reg_file[REGISTER][dest].word;
-            break;
-        case cmp:
-            temp = destination + (~source + 1);
-            update_psw(temp, emulator, old_dest, ~source);
-            break;
-        case xor:
-            destination ^= source;
-            update_psw(destination, emulator, old_dest, source);
-            break;
-        case and:
-            destination &= source;
-            update_psw(destination, emulator, old_dest, source);
-            break;
-        case or:
-            destination |= source;
-            update_psw(destination, emulator, old_dest, source);
-            break;
-        case bit: // bit test
-            temp = destination & (1 << source);
-            update_psw(temp, emulator, old_dest, source);
-            break;
-        case bic: // bit clear
-            destination &= ~(1 << source);
-            update_psw(destination, emulator, old_dest, source);
-            break;
-        case bis: // bit set
-            destination |= (1 << source);
-            update_psw(destination, emulator, old_dest, source);
-            break;
-        default:
-            break;
-    }
-    if (wb == WORD)
-    {
-        emulator->reg_file[rc][sc].word = source;
-        emulator->reg_file[REGISTER][dest].word = destination;
-    }
-    else
-    {
-        emulator->reg_file[rc][sc].byte[LSB] = source;
-        emulator->reg_file[REGISTER][dest].byte[LSB] = destination;
-    }
-}
-
-/*
- * @brief This function updates the program status word based on the result of
- * executed operations, not all operations will cause this function to be called
- * @param result the result of the previous operation
- * @param emulator the emulator struct for updating the psw
- * @param old_dest the value of the destination register before the operation
- * @param source the value of the source register or constant used in the operation, one's complement is passed
- * for subtraction operations (sub, subc, cmp)
- */
-void update_psw(unsigned short result, Emulator *emulator, unsigned short old_dest, unsigned short source) {
-    unsigned short ms_bit;
-    unsigned char shift_size;
-    if (emulator->inst_operands.word_or_byte == WORD)
+    if (emulator->opcode == dadd)
     {
-        ms_bit = WORD_MSb;
-        shift_size = WORD_SHIFT;
-        emulator->psw.bits.negative = result & ms_bit ? 1 : 0;
+        //DADD reads whole registers in both widths, and DADD.B clears the upper byte of the destination
+        out = alu_dadd(emulator->reg_file[REGISTER][dest].word, emulator->reg_file[rc][sc].word, wb,
+                       emulator->psw.bits.carry);
+        emulator->reg_file[REGISTER][dest].word = ALU_RESULT(out);
     }
-    else
+    else if (wb == WORD)
     {
-        ms_bit = BYTE_MSb;
-        shift_size = BYTE_SHIFT;
-        emulator->psw.bits.negative = result & ms_bit ? 1 : 0;
-
-    }
-    emulator->psw.bits.zero = result == 0 ? 1 : 0;
-    //only add, sub, addc, subc, and rrc set the carry. RRC handles the carry in its case
-    if (emulator->opcode < xor)
-    {
-        emulator->psw.bits.carry = carry_check[(source & ms_bit) >> shift_size][(old_dest & ms_bit) >> shift_size][
-                (result & ms_bit) >> shift_size];
-        emulator->psw.bits.overflow = overflow_check[(source & ms_bit) >> shift_size][(old_dest & ms_bit)
-                >> shift_size][(result & ms_bit) >> shift_size];
-    }
-}
-
-#define RESET_HEX 10
-
-/*
- * @brief This function performs a binary coded decimal addition on the source and destination registers
- *
- */
-void bcd_addition(Emulator *emulator) {
-    //set operand values to local variables
-    unsigned char dest = emulator->inst_operands.dest;
-    unsigned char wb = emulator->inst_operands.word_or_byte;
-    unsigned char rc = emulator->inst_operands.register_or_constant;
-    unsigned char sc = emulator->inst_operands.source_const;
-    //create nibble structs to hold the bcd values
-    word_nibbles source_bcd;
-    word_nibbles dest_bcd;
-    word_nibbles result_bcd;
-
-    //set the values of the nibbles to the values of the registers
-    dest_bcd.word = emulator->reg_file[REGISTER][dest].word;
-    source_bcd.word = emulator->reg_file[rc][sc].word;
-
-    //check if the values are greater than 9
-    if (source_bcd.word > 0x09)
-    {
-        //if the values from the constants table are either 16 or 32 then convert them to bcd
-        switch (source_bcd.word)
+        out = alu_kernels[WORD][emulator->opcode - add](emulator->reg_file[REGISTER][dest].word,
+                                                        emulator->reg_file[rc][sc].word, emulator->psw.bits.carry);
+        if (emulator->opcode != cmp && emulator->opcode != bit)
         {
-            case 16:
-                source_bcd.nibbles.nib1 = 1;
-                source_bcd.nibbles.nib0 = 6;
-                break;
-            case 32:
-                source_bcd.nibbles.nib1 = 3;
-                source_bcd.nibbles.nib0 = 2;
-                break;
-                //default case is for the case where the value is not 16 or 32 which means found a hex value that is not
-                //a bcd value for us to handle, programmer is responsible
-            default:
-                break;
+            emulator->reg_file[REGISTER][dest].word = ALU_RESULT(out);
         }
     }
-    //work our way up from lower nibble to highest nibble, if the value exceeds 9 then subtract 10 and add 1 to the next nibble
-    result_bcd.nibbles.nib0 += dest_bcd.nibbles.nib0 + source_bcd.nibbles.nib0;
-    if (result_bcd.nibbles.nib0 > 9)
-    {
-        result_bcd.nibbles.nib0 -= RESET_HEX;
-        result_bcd.nibbles.nib1++;
-    }
-    result_bcd.nibbles.nib1 += dest_bcd.nibbles.nib1 + source_bcd.nibbles.nib1;
-    if (result_bcd.nibbles.nib1 > 9)
-    {
-        result_bcd.nibbles.nib1 -= RESET_HEX;
-        //if dadd.b set the carry flag and don't increment the next nibble, else increment the next nibble
-        wb == WORD ? result_bcd.nibbles.nib2++ : (emulator->psw.bits.carry = 1);
-    }
-    if (wb == WORD)
+    else
     {
-        result_bcd.nibbles.nib2 += dest_bcd.nibbles.nib2 + source_bcd.nibbles.nib2;
-        if (result_bcd.nibbles.nib2 > 9)
-        {
-            result_bcd.nibbles.nib2 -= RESET_HEX;
-            result_bcd.nibbles.nib3++;
-        }
-        result_bcd.nibbles.nib3 += dest_bcd.nibbles.nib3 + source_bcd.nibbles.nib3;
-        if (result_bcd.nibbles.nib3 > 9)
+        out = alu_kernels[BYTE][emulator->opcode - add](emulator->reg_file[REGISTER][dest].byte[LSB],
+                                                        emulator->reg_file[rc][sc].byte[LSB], emulator->psw.bits.carry);
+        if (emulator->opcode != cmp && emulator->opcode != bit)
         {
-            result_bcd.nibbles.nib3 -= RESET_HEX;
-            emulator->psw.bits.carry = 1;
+            emulator->reg_file[REGISTER][dest].byte[LSB] = ALU_RESULT(out);
         }
-        else
-        {
-            emulator->psw.bits.carry = 0;
-        }
-    }
-    if ((result_bcd.word == 0 && emulator->inst_operands.word_or_byte == WORD)
-        || ((result_bcd.word & 0x00FF) == 0 && emulator->inst_operands.word_or_byte == BYTE))
-    {
-        emulator->psw.bits.zero = 1;
     }
-    else
-    {
-        emulator->psw.bits.zero = 0;
-    }
-    //set the result of the bcd addition to the destination register
-    emulator->reg_file[REGISTER][dest].word = result_bcd.word;
-}
\ No newline at end of file
+    emulator->psw.word = (emulator->psw.word & ~flag_mask) | (ALU_FLAGS(out) & flag_mask);
+}
@@ -0,0 +1,686 @@
+/*
+ * File Name: gdb_stub.c
+ * Date October 19 2026
+ * Module Info: This module implements a GDB remote serial protocol server, listening on a localhost TCP port or a
+ * Unix socket for one debugger at a time. Between stops the program runs through functional_step, the same
+ * executor sampled simulation fast-forwards with, so a continue runs at full speed and the socket is only polled
+ * for an interrupt every GDB_POLL_STEPS instructions.
+ *
+ * Registers are sent in the order R0-R6, PC, PSW, 16 bits each and little-endian. The PC is the address of the next
+ * instruction to execute, writing it restarts fetch there. I-memory is mapped at 0x0000-0xFFFF and D-memory at
+ * GDB_DATA_MEMORY_BASE, m/M/X move up to a whole packet of either at once.
+ */
+#include "emulation.h"
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define GDB_PACKET_SIZE 0x4000 //payload size advertised in qSupported
+#define GDB_BUFFER_SIZE (GDB_PACKET_SIZE + 8) //payload plus the $, # and checksum
+#define GDB_POLL_STEPS (1 << 16)
+#define GDB_REGISTERS (REGFILE_SIZE + 1) //R0-R7 and the PSW
+#define GDB_PSW_REGISTER REGFILE_SIZE
+#define GDB_INTERRUPT 0x03
+#define GDB_ESCAPE 0x7D
+#define GDB_ESCAPE_XOR 0x20
+#define SIGNAL_INT 2
+#define SIGNAL_TRAP 5
+
+typedef struct gdb_session
+{
+    Emulator *emulator;
+    int fd;
+    bool no_ack;
+    unsigned char *breakpoints; //one byte per I-memory word, set where a Z0 or Z1 breakpoint is inserted
+    unsigned char input[GDB_BUFFER_SIZE];
+    size_t input_length;
+    size_t input_position;
+    char packet[GDB_BUFFER_SIZE];
+    char reply[GDB_BUFFER_SIZE];
+}GdbSession;
+
+static const char hex_digits[] = "0123456789abcdef";
+
+static int hex_value(char digit)
+{
+    if (digit >= '0' && digit <= '9')
+    {
+        return digit - '0';
+    }
+    digit = (char)tolower(digit);
+    return (digit >= 'a' && digit <= 'f') ? digit - 'a' + 10 : -1;
+}
+
+/*
+ * @brief next byte from the debugger, reading a buffer at a time
+ * @return the byte, or -1 once the debugger disconnects
+ */
+static int read_byte(GdbSession *session)
+{
+    ssize_t received;
+    if (session->input_position == session->input_length)
+    {
+        do
+        {
+            received = recv(session->fd, session->input, sizeof(session->input), 0);
+        } while (received < 0 && errno == EINTR);
+        if (received <= 0)
+        {
+            return -1;
+        }
+        session->input_length = (size_t)received;
+        session->input_position = 0;
+    }
+    return session->input[session->input_position++];
+}
+
+static bool write_all(int fd, const char *data, size_t length)
+{
+    ssize_t sent;
+    while (length > 0)
+    {
+        sent = send(fd, data, length, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (sent <= 0)
+        {
+            return false;
+        }
+        data += sent;
+        length -= (size_t)sent;
+    }
+    return true;
+}
+
+/*
+ * @brief This function frames the reply as $reply#checksum and sends it in one write, resending until it is
+ * acknowledged unless no-ack mode is on
+ */
+static bool send_packet(GdbSession *session, const char *payload)
+{
+    static char frame[GDB_BUFFER_SIZE];
+    size_t length = strlen(payload);
+    unsigned char checksum = 0;
+    int ack;
+    frame[0] = '$';
+    for (size_t i = 0; i < length; ++i)
+    {
+        checksum += (unsigned char)payload[i];
+    }
+    memcpy(frame + 1, payload, length);
+    frame[length + 1] = '#';
+    frame[length + 2] = hex_digits[checksum >> 4];
+    frame[length + 3] = hex_digits[checksum & 0x0F];
+    do
+    {
+        if (!write_all(session->fd, frame, length + 4))
+        {
+            return false;
+        }
+        if (session->no_ack)
+        {
+            return true;
+        }
+        ack = read_byte(session);
+    } while (ack == '-');
+    return ack == '+';
+}
+
+/*
+ * @brief This function reads the next packet into session->packet, acknowledging it
+ * @return the payload length, 0 for an interrupt byte outside a packet, or -1 once the debugger disconnects
+ */
+static int read_packet(GdbSession *session)
+{
+    int byte;
+    int length;
+    unsigned char checksum;
+    int high;
+    int low;
+    while (true)
+    {
+        do
+        {
+            byte = read_byte(session);
+            if (byte == GDB_INTERRUPT)
+            {
+                session->packet[0] = '\0';
+                return 0;
+            }
+        } while (byte != '$' && byte != -1);
+        if (byte == -1)
+        {
+            return -1;
+        }
+        length = 0;
+        checksum = 0;
+        while ((byte = read_byte(session)) != '#' && byte != -1)
+        {
+            if (length < GDB_PACKET_SIZE)
+            {
+                session->packet[length++] = (char)byte;
+            }
+            checksum += (unsigned char)byte;
+        }
+        high = read_byte(session);
+        low = read_byte(session);
+        if (byte == -1 || high == -1 || low == -1)
+        {
+            return -1;
+        }
+        session->packet[length] = '\0';
+        if (session->no_ack)
+        {
+            return length;
+        }
+        if (hex_value((char)high) << 4 == (checksum & 0xF0) && hex_value((char)low) == (checksum & 0x0F))
+        {
+            write_all(session->fd, "+", 1);
+            return length;
+        }
+        write_all(session->fd, "-", 1);
+    }
+}
+
+static unsigned short read_gdb_register(Emulator *emulator, int reg)
+{
+    if (reg == PROG_COUNTER)
+    {
+        return next_execute_address(emulator);
+    }
+    return reg == GDB_PSW_REGISTER ? emulator->psw.word : emulator->reg_file[REGISTER][reg].word;
+}
+
+static void write_gdb_register(Emulator *emulator, int reg, unsigned short value)
+{
+    if (reg == PROG_COUNTER)
+    {
+        redirect_execution(emulator, value);
+    }
+    else if (reg == GDB_PSW_REGISTER)
+    {
+        emulator->psw.word = value;
+    }
+    else
+    {
+        emulator->reg_file[REGISTER][reg].word = value;
+    }
+}
+
+/*
+ * @brief byte of I-memory or D-memory at a GDB address
+ * @return NULL above the end of D-memory
+ */
+static unsigned char *memory_byte(unsigned long int address)
+{
+    if (address >= GDB_DATA_MEMORY_BASE + (BYTE_MEMORY_SIZE))
+    {
+        return NULL;
+    }
+    return address >= GDB_DATA_MEMORY_BASE ? &xm23_memory[D_MEMORY].byte[address - GDB_DATA_MEMORY_BASE]
+                                           : &xm23_memory[I_MEMORY].byte[address];
+}
+
+static void append_hex_word(char *out, unsigned short value)
+{
+    //little-endian, the low byte first
+    out[0] = hex_digits[(value >> 4) & 0x0F];
+    out[1] = hex_digits[value & 0x0F];
+    out[2] = hex_digits[(value >> 12) & 0x0F];
+    out[3] = hex_digits[(value >> 8) & 0x0F];
+}
+
+static bool parse_hex_word(const char *in, unsigned short *value)
+{
+    int digits[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        if ((digits[i] = hex_value(in[i])) < 0)
+        {
+            return false;
+        }
+    }
+    *value = (unsigned short)(digits[0] << 4 | digits[1] | digits[2] << 12 | digits[3] << 8);
+    return true;
+}
+
+static void reply_registers(GdbSession *session)
+{
+    for (int reg = 0; reg < GDB_REGISTERS; ++reg)
+    {
+        append_hex_word(session->reply + reg * 4, read_gdb_register(session->emulator, reg));
+    }
+    session->reply[GDB_REGISTERS * 4] = '\0';
+}
+
+static const char *write_registers(GdbSession *session, const char *in)
+{
+    unsigned short value;
+    for (int reg = 0; reg < GDB_REGISTERS; ++reg)
+    {
+        if (!parse_hex_word(in + reg * 4, &value))
+        {
+            return "E01";
+        }
+        write_gdb_register(session->emulator, reg, value);
+    }
+    return "OK";
+}
+
+/*
+ * @brief m addr,length, reads at most half a packet since every byte takes two hex digits
+ */
+static const char *read_memory(GdbSession *session, const char *in)
+{
+    char *end;
+    unsigned long int address = strtoul(in, &end, 16);
+    unsigned long int length = *end == ',' ? strtoul(end + 1, NULL, 16) : 0;
+    unsigned char *byte;
+    length = length < GDB_PACKET_SIZE / 2 ? length : GDB_PACKET_SIZE / 2;
+    for (unsigned long int i = 0; i < length; ++i)
+    {
+        if ((byte = memory_byte(address + i)) == NULL)
+        {
+            if (i == 0)
+            {
+                return "E01";
+            }
+            length = i;
+            break;
+        }
+        session->reply[i * 2] = hex_digits[*byte >> 4];
+        session->reply[i * 2 + 1] = hex_digits[*byte & 0x0F];
+    }
+    session->reply[length * 2] = '\0';
+    return session->reply;
+}
+
+/*
+ * @brief M addr,length:hex and X addr,length:binary, X escapes $, #, } and * as } followed by the byte ^ 0x20
+ */
+static const char *write_memory(GdbSession *session, const char *in, int packet_length, bool binary)
+{
+    char *end;
+    unsigned long int address = strtoul(in, &end, 16);
+    unsigned long int length;
+    const char *data;
+    const char *packet_end = session->packet + packet_length;
+    unsigned char *byte;
+    int high;
+    int low;
+    if (*end != ',')
+    {
+        return "E01";
+    }
+    length = strtoul(end + 1, &end, 16);
+    if (*end != ':')
+    {
+        return "E01";
+    }
+    data = end + 1;
+    for (unsigned long int i = 0; i < length; ++i)
+    {
+        if ((byte = memory_byte(address + i)) == NULL)
+        {
+            return "E01";
+        }
+        if (binary)
+        {
+            if (data >= packet_end)
+            {
+                return "E01";
+            }
+            *byte = *data == GDB_ESCAPE && data + 1 < packet_end ? (unsigned char)(*++data ^ GDB_ESCAPE_XOR)
+                                                                  : (unsigned char)*data;
+            data++;
+        }
+        else
+        {
+            if (data + 1 >= packet_end || (high = hex_value(data[0])) < 0 || (low = hex_value(data[1])) < 0)
+            {
+                return "E01";
+            }
+            *byte = (unsigned char)(high << 4 | low);
+            data += 2;
+        }
+    }
+    return "OK";
+}
+
+/*
+ * @brief Z0/Z1 addr,kind inserts and z0/z1 removes a breakpoint, software and hardware breakpoints are the same here
+ */
+static const char *change_breakpoint(GdbSession *session, const char *in, bool insert)
+{
+    unsigned long int address;
+    if ((in[0] != '0' && in[0] != '1') || in[1] != ',')
+    {
+        return "";
+    }
+    address = strtoul(in + 2, NULL, 16);
+    if (address >= (BYTE_MEMORY_SIZE))
+    {
+        return "E01";
+    }
+    session->breakpoints[address >> 1] = insert;
+    return "OK";
+}
+
+/*
+ * @brief This function checks the socket for an interrupt from the debugger without blocking
+ */
+static bool interrupt_pending(GdbSession *session)
+{
+    struct pollfd poll_fd = {.fd = session->fd, .events = POLLIN};
+    int byte;
+    while (session->input_position < session->input_length || poll(&poll_fd, 1, 0) > 0)
+    {
+        byte = read_byte(session);
+        if (byte == GDB_INTERRUPT || byte == -1)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * @brief This function runs until a breakpoint, a branch to itself, the sleep bit, the clock limit, an interrupt
+ * from the debugger or ctrl-c, or after one instruction when single stepping
+ * @return the stop reply
+ */
+static const char *resume(GdbSession *session, bool single_step)
+{
+    Emulator *emulator = session->emulator;
+    unsigned long int steps = 0;
+    int signal_number = SIGNAL_TRAP;
+    bool executed;
+    bool stepped = false;
+    stop_loop = 0;
+    signal(SIGINT, int_handler);
+    while (true)
+    {
+        if (emulator->psw.bits.sleep)
+        {
+            //nothing wakes a sleeping core, the clock runs out to the limit if there is one
+            sleep_until_clock(emulator, emulator->clock_limit);
+            break;
+        }
+        executed = functional_step(emulator);
+        if (executed && branched_to_self(emulator))
+        {
+            break;
+        }
+        stepped |= executed;
+        //a single step also runs the flush bubble after a taken branch, so it stops with the PC at the target.
+        //breakpoints are only checked after an instruction, a bubble pending from the branch that reached the
+        //breakpoint would otherwise stop the next continue where it started
+        if ((single_step && stepped && !emulator->hazard_control.d_bubble) ||
+            (executed && session->breakpoints[next_execute_address(emulator) >> 1]))
+        {
+            break;
+        }
+        if (emulator->clock_limit != 0 && emulator->clock >= emulator->clock_limit)
+        {
+            break;
+        }
+        if (++steps % GDB_POLL_STEPS == 0 && (stop_loop || interrupt_pending(session)))
+        {
+            signal_number = SIGNAL_INT;
+            break;
+        }
+    }
+    stop_loop = 0;
+    settle_pipeline(emulator);
+    snprintf(session->reply, sizeof(session->reply), "S%02x", signal_number);
+    return session->reply;
+}
+
+/*
+ * @brief This function answers packets until the debugger detaches, kills the session or disconnects
+ */
+static void serve_session(GdbSession *session)
+{
+    int length;
+    const char *reply;
+    char *end;
+    unsigned long int reg;
+    unsigned short value;
+
+    while ((length = read_packet(session)) >= 0)
+    {
+        switch (session->packet[0])
+        {
+            case '\0':
+                //an interrupt while already stopped
+                reply = "S02";
+                break;
+            case '?':
+                reply = "S05";
+                break;
+            case 'g':
+                reply_registers(session);
+                reply = session->reply;
+                break;
+            case 'G':
+                reply = write_registers(session, session->packet + 1);
+                break;
+            case 'p':
+                reg = strtoul(session->packet + 1, NULL, 16);
+                if (reg >= GDB_REGISTERS)
+                {
+                    reply = "E01";
+                    break;
+                }
+                append_hex_word(session->reply, read_gdb_register(session->emulator, (int)reg));
+                session->reply[4] = '\0';
+                reply = session->reply;
+                break;
+            case 'P':
+                reg = strtoul(session->packet + 1, &end, 16);
+                if (reg >= GDB_REGISTERS || *end != '=' || !parse_hex_word(end + 1, &value))
+                {
+                    reply = "E01";
+                    break;
+                }
+                write_gdb_register(session->emulator, (int)reg, value);
+                reply = "OK";
+                break;
+            case 'm':
+                reply = read_memory(session, session->packet + 1);
+                break;
+            case 'M':
+                reply = write_memory(session, session->packet + 1, length, false);
+                break;
+            case 'X':
+                reply = write_memory(session, session->packet + 1, length, true);
+                break;
+            case 'c':
+            case 's':
+                if (session->packet[1] != '\0')
+                {
+                    write_gdb_register(session->emulator, PROG_COUNTER,
+                                       (unsigned short)strtoul(session->packet + 1, NULL, 16));
+                }
+                reply = resume(session, session->packet[0] == 's');
+                break;
+            case 'Z':
+            case 'z':
+                reply = change_breakpoint(session, session->packet + 1, session->packet[0] == 'Z');
+                break;
+            case 'H':
+                reply = "OK";
+                break;
+            case 'D':
+                send_packet(session, "OK");
+                return;
+            case 'k':
+                return;
+            case 'q':
+                if (strncmp(session->packet, "qSupported", 10) == 0)
+                {
+                    snprintf(session->reply, sizeof(session->reply), "PacketSize=%x;QStartNoAckMode+",
+                             GDB_PACKET_SIZE);
+                    reply = session->reply;
+                }
+                else if (strcmp(session->packet, "qAttached") == 0)
+                {
+                    reply = "1";
+                }
+                else if (strcmp(session->packet, "qC") == 0)
+                {
+                    reply = "QC1";
+                }
+                else if (strcmp(session->packet, "qfThreadInfo") == 0)
+                {
+                    reply = "m1";
+                }
+                else if (strcmp(session->packet, "qsThreadInfo") == 0)
+                {
+                    reply = "l";
+                }
+                else
+                {
+                    reply = "";
+                }
+                break;
+            case 'Q':
+                if (strcmp(session->packet, "QStartNoAckMode") == 0)
+                {
+                    //acknowledged normally, every packet after it is not
+                    send_packet(session, "OK");
+                    session->no_ack = true;
+                    continue;
+                }
+                reply = "";
+                break;
+            default:
+                reply = "";
+                break;
+        }
+        if (!send_packet(session, reply))
+        {
+            return;
+        }
+    }
+}
+
+/*
+ * @brief This function opens the listening socket
+ * @param address a port number to listen on localhost, anything else is the path of a Unix socket
+ * @return the socket, or -1 if it could not be opened
+ */
+static int open_listener(const char *address)
+{
+    struct sockaddr_in tcp_address = {0};
+    struct sockaddr_un unix_address = {0};
+    char *end;
+    unsigned long int port = strtoul(address, &end, 10);
+    int reuse = 1;
+    int fd;
+
+    if (*address != '\0' && *end == '\0')
+    {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0 || port == 0 || port > 0xFFFF)
+        {
+            if (fd >= 0) close(fd);
+            return -1;
+        }
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        tcp_address.sin_family = AF_INET;
+        tcp_address.sin_port = htons((unsigned short)port);
+        tcp_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(fd, (struct sockaddr *)&tcp_address, sizeof(tcp_address)) < 0 || listen(fd, 1) < 0)
+        {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    if (strlen(address) >= sizeof(unix_address.sun_path) || (fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+    {
+        return -1;
+    }
+    unix_address.sun_family = AF_UNIX;
+    strcpy(unix_address.sun_path, address);
+    unlink(address);
+    if (bind(fd, (struct sockaddr *)&unix_address, sizeof(unix_address)) < 0 || listen(fd, 1) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/*
+ * @brief This function waits for a debugger and serves it until it detaches or disconnects
+ * @return 0 once the session ends, -1 if the server could not be started
+ */
+int run_gdb_server(Emulator *emulator, const char *address)
+{
+    GdbSession *session;
+    int listener = open_listener(address);
+    int nodelay = 1;
+    if (listener < 0)
+    {
+        printf("Could not listen on %s\n", address);
+        return -1;
+    }
+    session = calloc(1, sizeof(GdbSession));
+    if (session == NULL || (session->breakpoints = calloc(WORD_MEMORY_SIZE, 1)) == NULL)
+    {
+        free(session);
+        close(listener);
+        return -1;
+    }
+    session->emulator = emulator;
+    printf("Waiting for GDB on %s\n", address);
+    fflush(stdout);
+    do
+    {
+        session->fd = accept(listener, NULL, NULL);
+    } while (session->fd < 0 && errno == EINTR);
+    close(listener);
+    if (session->fd >= 0)
+    {
+        setsockopt(session->fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+        printf("GDB connected\n");
+        serve_session(session);
+        close(session->fd);
+        printf("GDB disconnected at PC %04X, clock %lu\n", next_execute_address(emulator), emulator->clock);
+    }
+    if (!isdigit((unsigned char)address[0]))
+    {
+        unlink(address);
+    }
+    free(session->breakpoints);
+    free(session);
+    return 0;
+}
+
+/*
+ * @brief This function asks for the port or socket path and starts the server
+ */
+void gdb_server_menu(Emulator *emulator)
+{
+    char address[MAX_RECORD_LEN];
+    if (!emulator->is_memset)
+    {
+        printf("No file loaded, cannot start the debug server\n");
+        return;
+    }
+    printf("Enter port on localhost or Unix socket path: ");
+    if (scanf("%70s", address) != 1)
+    {
+        printf("Invalid address\n");
+        return;
+    }
+    run_gdb_server(emulator, address);
+}
@@ -0,0 +1,238 @@
+/*
+ * File Name: idle.c
+ * Date October 19 2026
+ * Module Info: This module lets the emulator skip clocks in which the guest only waits. Two idle states are
+ * recognised:
+ *   - the PSW sleep bit, set by SETCC. A sleeping core executes nothing and this emulator has no interrupts to wake
+ *     it, so the clock jumps straight to the next scheduled event, or the run halts if nothing is scheduled.
+ *   - a branch to itself (BRA $). By default the run halts there as before. With loop skipping on and an event
+ *     scheduled, the loop is run until it comes around twice in the same pipeline and predictor state. Every lap
+ *     after that adds exactly what the last one did, so whole laps up to the event are added to the clock, the
+ *     statistics, the predictor counters and the branch profile at once, and the remainder runs normally.
+ *
+ * The functional executor in sampling.c treats a sleeping core the same way: fast-forwarding hands it to the
+ * detailed loop, and the GDB stub and control server sleep it to the clock they stop at or end the run.
+ *
+ * The scheduled events are the ones the run loop stops or acts on: the clock limit, the clock budget of this call
+ * to run_emulator, the end of a sampled simulation window, the sampler's next check and single stepping. The clock,
+ * the statistics and the performance counters read the same as if every idle clock had been run. Pipeline models
+ * and the I-cache model replay every fetched instruction, so with either configured the loop is run without
+ * skipping.
+ */
+#include "emulation.h"
+
+/*
+ * @brief This function finds the first clock from a given one on at which the run loop has something to do
+ * @param budget_end the clock the budget of this run ends at, 0 for no budget
+ * @param earliest the first clock that counts
+ * @return the clock, or 0 if nothing is scheduled
+ */
+static unsigned long int next_event(Emulator *emulator, unsigned long int budget_end, unsigned long int earliest)
+{
+    unsigned long int event = 0;
+    unsigned long int candidates[5] = {emulator->clock_limit, budget_end, 0, 0, 0};
+    SamplingConfig *sampling = &emulator->sampling;
+    if (sampling->mode != FAST_FORWARD_OFF && sampling->window_clocks != 0)
+    {
+        //windows end on the first even clock at or past their length
+        candidates[2] = sampling->window_start + sampling->window_clocks + (sampling->window_clocks & 1);
+    }
+    if (emulator->sample_profile != NULL)
+    {
+        candidates[3] = emulator->sample_profile->next_check_clock;
+    }
+    if (emulator->is_single_step)
+    {
+        candidates[4] = emulator->clock + 1;
+    }
+    for (int i = 0; i < sizeof(candidates) / sizeof(candidates[0]); ++i)
+    {
+        if (candidates[i] >= earliest && candidates[i] != 0 && (event == 0 || candidates[i] < event))
+        {
+            event = candidates[i];
+        }
+    }
+    return event;
+}
+
+/*
+ * @brief This function idles a sleeping core until the next event, or finishes the clock pair it woke up in
+ * @return false if the core is asleep with nothing scheduled, the run is then over
+ */
+bool sleep_until_event(Emulator *emulator, unsigned long int budget_end)
+{
+    unsigned long int event;
+    if (!emulator->psw.bits.sleep)
+    {
+        //woken on an odd clock, the even clock that follows starts the next instruction slot
+        emulator->clock++;
+        emulator->stats.clocks++;
+        emulator->idle.idle_clocks++;
+        return true;
+    }
+    emulator->idle.asleep = true;
+    event = next_event(emulator, budget_end, emulator->clock + 1);
+    if (event == 0)
+    {
+        return false;
+    }
+    if (!emulator->is_quiet)
+    {
+        printf("%-5lu asleep until clock %lu\n", emulator->clock, event);
+    }
+    emulator->idle.idle_clocks += event - emulator->clock;
+    emulator->stats.clocks += event - emulator->clock;
+    emulator->clock = event;
+    return true;
+}
+
+/*
+ * @brief This function idles a core the functional executor found asleep, for the callers of functional_step whose
+ * only event is a clock they stop at
+ * @param end the clock, 0 if there is none
+ * @return false if there is nothing to wake the core, the run is then over
+ */
+bool sleep_until_clock(Emulator *emulator, unsigned long int end)
+{
+    if (end <= emulator->clock)
+    {
+        return false;
+    }
+    if (!emulator->is_quiet)
+    {
+        printf("%-5lu asleep until clock %lu\n", emulator->clock, end);
+    }
+    emulator->idle.idle_clocks += end - emulator->clock;
+    emulator->clock = end;
+    return true;
+}
+
+static void read_idle_lap(Emulator *emulator, IdleLap *lap)
+{
+    lap->clock = emulator->clock;
+    lap->stats = emulator->stats;
+    lap->predictor = emulator->predictor;
+    lap->site = emulator->branch_profile[emulator->execute_address >> 1];
+    lap->hazard_control = emulator->hazard_control;
+    lap->program_counter = emulator->reg_file[REGISTER][PROG_COUNTER].word;
+    lap->fetch_address = emulator->i_control.IMAR;
+    lap->instruction_register = emulator->instruction_register;
+}
+
+/*
+ * @brief true when the loop came around in the state it was in last time, everything it does from here repeats
+ */
+static bool same_loop_state(const IdleLap *now, const IdleLap *last)
+{
+    return now->hazard_control.d_bubble == last->hazard_control.d_bubble &&
+           now->hazard_control.e_bubble == last->hazard_control.e_bubble &&
+           now->program_counter == last->program_counter && now->fetch_address == last->fetch_address &&
+           now->instruction_register == last->instruction_register &&
+           memcmp(now->predictor.btb, last->predictor.btb, sizeof(now->predictor.btb)) == 0 &&
+           memcmp(now->predictor.counters, last->predictor.counters, sizeof(now->predictor.counters)) == 0;
+}
+
+#define ADD_LAPS(field) (emulator->field += laps * (now->field - last->field))
+
+/*
+ * @brief This function adds what the last lap of the loop did, laps times over
+ */
+static void add_laps(Emulator *emulator, const IdleLap *now, const IdleLap *last, unsigned long int laps)
+{
+    BranchSite *site = &emulator->branch_profile[emulator->execute_address >> 1];
+    ADD_LAPS(clock);
+    ADD_LAPS(stats.clocks);
+    ADD_LAPS(stats.retired);
+    ADD_LAPS(stats.decode_bubbles);
+    ADD_LAPS(stats.execute_bubbles);
+    ADD_LAPS(stats.taken_branches);
+    ADD_LAPS(stats.loads);
+    ADD_LAPS(stats.stores);
+    ADD_LAPS(stats.invalid_instructions);
+    ADD_LAPS(predictor.resolved);
+    ADD_LAPS(predictor.mispredicted);
+    ADD_LAPS(predictor.cycles_saved);
+    site->executions += laps * (now->site.executions - last->site.executions);
+    site->taken += laps * (now->site.taken - last->site.taken);
+    site->bubble_cycles += laps * (now->site.bubble_cycles - last->site.bubble_cycles);
+    emulator->idle.idle_clocks += laps * (now->clock - last->clock);
+}
+
+/*
+ * @brief This function is called each time a branch to itself executes, it decides whether the run halts or the
+ * loop goes on, skipping ahead to the next event once the loop is steady
+ * @param budget_end the clock the budget of this run ends at, 0 for no budget
+ * @return false if the run halts
+ */
+bool skip_idle_loop(Emulator *emulator, unsigned long int budget_end)
+{
+    IdleState *idle = &emulator->idle;
+    IdleLap now;
+    unsigned long int event;
+    unsigned long int laps;
+    //an event at this clock counts, the run loop acts on it right after this instead of halting
+    if (!idle->skip_loops || (event = next_event(emulator, budget_end, emulator->clock)) == 0)
+    {
+        return false;
+    }
+    if (emulator->pipeline_model_count != 0 || emulator->caches[I_MEMORY] != NULL ||
+        emulator->reg_file[REGISTER][PROG_COUNTER].word == emulator->breakpoint)
+    {
+        //keep running lap by lap, the breakpoint stops the run right after this
+        return true;
+    }
+    read_idle_lap(emulator, &now);
+    if (idle->loop_laps == 0 || idle->loop_address != emulator->execute_address ||
+        !same_loop_state(&now, &idle->last))
+    {
+        //first time around or the predictor is still settling
+        idle->loop_address = emulator->execute_address;
+        idle->loop_laps = 1;
+        idle->last = now;
+        return true;
+    }
+    laps = (event - emulator->clock) / (now.clock - idle->last.clock);
+    if (laps != 0)
+    {
+        if (!emulator->is_quiet)
+        {
+            printf("%-5lu skipping %lu laps of the branch to itself at %04X\n", emulator->clock, laps,
+                   emulator->execute_address);
+        }
+        add_laps(emulator, &now, &idle->last, laps);
+        read_idle_lap(emulator, &now);
+    }
+    idle->last = now;
+    return true;
+}
+
+/*
+ * @brief This function turns skipping branches to themselves on or off and prints the clocks spent idle
+ */
+void idle_menu(Emulator *emulator)
+{
+    char command;
+    printf("Enter S to skip branches to themselves up to the next event, H to halt on them, R for the idle clocks: ");
+    if (scanf(" %c", &command) != 1)
+    {
+        return;
+    }
+    switch (toupper(command))
+    {
+        case 'S':
+            emulator->idle.skip_loops = true;
+            printf("Skipping idle loops\n");
+            break;
+        case 'H':
+            emulator->idle.skip_loops = false;
+            printf("Halting on idle loops\n");
+            break;
+        case 'R':
+            printf("Idle clocks: %lu, %s\n", emulator->idle.idle_clocks,
+                   emulator->psw.bits.sleep ? "asleep" : "awake");
+            break;
+        default:
+            printf("Invalid idle command\n");
+            break;
+    }
+}
@@ -9,6 +9,7 @@
 
 #include "loader.h"
 #include "emulation.h"
+#include <unistd.h>
 #define CHAR_TO_INT(x) ((x)- '0')
 
 
@@ -144,20 +145,27 @@ void store_in_memory(int type, int record_address, int record_length, unsigned c
     switch(type)
     {
         case 0:
-            printf("Loaded File: %s\n", parsed_data);
+            if (!emulator->is_quiet) printf("Loaded File: %s\n", parsed_data);
             break;
         case 1:
             //fall through to case2 as both operations are the same
         case 2:
-            memcpy(xm23_memory[type - 1].byte + record_address, parsed_data,
-                   record_length);
-            printf("S%d Stored\n", type);
+            //the length counts the address and checksum too, copying them ran past the data and past the end of memory
+            record_length -= RECORD_OVERHEAD;
+            if (record_length > (BYTE_MEMORY_SIZE) - record_address)
+            {
+                record_length = (BYTE_MEMORY_SIZE) - record_address;
+            }
+            if (record_length > 0)
+            {
+                memcpy(xm23_memory[type - 1].byte + record_address, parsed_data, record_length);
+            }
+            if (!emulator->is_quiet) printf("S%d Stored\n", type);
             break;
         case 9:
             emulator->starting_address = (short) record_address;
             emulator->reg_file[REGISTER][PROG_COUNTER].word = emulator->starting_address;
-            printf("Program starting Addr = %04x\n",
-                   emulator->starting_address);
+            if (!emulator->is_quiet) printf("Program starting Addr = %04x\n", emulator->starting_address);
             break;
         default:
             printf("Unknown Type {%d} record not stored\n", type);
@@ -178,8 +186,15 @@ void display_loader_memory()
     scanf("%4x %4x %c", &lower_lookup, &upper_lookup, &mem_type);
     printf("Entered Memory bounds %4x --> %4x\n", lower_lookup, upper_lookup);
 
-    mem_type = toupper(mem_type) == 'I' ? INSTR : DATA;
+    dump_memory(lower_lookup, upper_lookup, toupper(mem_type) == 'I' ? INSTR : DATA);
+}
 
+/*
+ * @brief dump_memory prints memory from lower_lookup up to upper_lookup, used by the menu and the command line
+ * @param mem_type INSTR or DATA
+ */
+void dump_memory(int lower_lookup, int upper_lookup, int mem_type)
+{
     if(lower_lookup < 0 || lower_lookup > BYTE_MEMORY_SIZE)
     {
         printf("Invalid lower bound, clamping to 0\n");
@@ -191,36 +206,13 @@ void display_loader_memory()
         upper_lookup = 0xFFFF;
     }
 
-    //loop through loader memory from lower to upper bounds and print out the values
-    for (int i = lower_lookup; i < upper_lookup; ++i)
+    //lines are built in a buffer and written together, the characters after each line are that line's bytes
+    fflush(stdout);
+    if (lower_lookup < upper_lookup && !export_memory(STDOUT_FILENO, mem_type, lower_lookup, upper_lookup,
+                                                      EXPORT_HEX_DUMP, 0))
     {
-        //insert address every 16 bytes
-        if (i % MEMORY_LINE_LENGTH == 0)
-        {
-            printf("%04x: ", i);
-        }
-        printf("%02x, ", xm23_memory[mem_type].byte[i]);
-        if (i > lower_lookup && (i + 1) % MEMORY_LINE_LENGTH == 0)
-        {
-            //add spaces between the hex and ascii values
-            printf("       ");
-            //print ascii version of the 16 bytes inserting periods for none ascii characters
-            for (int j = i - MEMORY_LINE_LENGTH; j < i; ++j)
-            {
-                //check if it's a printable character
-                if (isprint(xm23_memory[mem_type].byte[j]))
-                {
-                    printf("%c", xm23_memory[mem_type].byte[j]);
-                }
-                else
-                {
-                    printf(".");
-                }
-            }
-            printf("\n");
-        }
+        printf("Failed to write memory\n");
     }
-
 }
 void parse_data(char *string_data, unsigned char **converted_data,
                 unsigned char *sum) {
@@ -23,6 +23,7 @@
 #define MEMORY_LINE_LENGTH 16
 #define MAX_RECORD_LEN (70+1)
 #define VALID_CHECKSUM 255
+#define RECORD_OVERHEAD 3 //the address and checksum bytes counted in a record's length
 #define BYTE_MEMORY_SIZE 1<<16
 #define WORD_MEMORY_SIZE 1<<15
 #define REG_FILE_OPTIONS 2
@@ -63,11 +64,12 @@ void clean_data(char *s_record, Emulator *emulator);
 void store_in_memory(int type, int record_address, int record_length, unsigned char *parsed_data, Emulator *emulator);
 bool record_check(char * s_record);
 void display_loader_memory();
+void dump_memory(int lower_lookup, int upper_lookup, int mem_type);
 
 
 
 extern FILE* input_file;
 extern unsigned char IMEM[BYTE_MEMORY_SIZE];
 extern unsigned char DMEM[BYTE_MEMORY_SIZE];
-extern Memory xm23_memory[2];
+extern Memory *xm23_memory; //I-memory and D-memory being emulated, control sessions point it at their own
 #endif //ASSIGNMENT1_LOADER_H
@@ -0,0 +1,859 @@
+/*
+ * File Name: lockstep.c
+ * Date October 19 2026
+ * Module Info: This module runs many instances of the same program at once for fuzzing and parameter sweeps. The
+ * instances (lanes) keep their registers, PSW and next instruction address in structure of arrays rows so sixteen
+ * lanes fit one AVX2 register, and every step executes the instruction at one address for all the lanes waiting
+ * there. Each lane has its own D-memory, I-memory is shared.
+ *
+ * Lanes follow the functional executor in sampling.c instruction for instruction, so a lane ends with the same
+ * registers, PSW and memory as a scalar emulator run on its inputs. R7 in a lane holds the fetch address, two past
+ * the next instruction, and is advanced by two when an instruction executes the same way F0 does:
+ *   - an instruction that writes R7 or takes a branch flushes, the lane continues at the new R7 and is charged a
+ *     bubble
+ *   - a load completes before the next instruction, a load into R7 lets the word after it execute first
+ *   - a branch to itself or the sleep bit ends the lane, nothing changes from then on
+ *
+ * When lanes diverge the group runs the lowest address any lane is waiting at, so lanes that skipped ahead wait for
+ * the others to catch up. Lanes left waiting for LOCKSTEP_DIVERGENCE_LIMIT steps are evicted and finished one at a
+ * time by the scalar path. Branches, arithmetic other than DADD, MOV, MOVL..MOVH and SETCC/CLRCC run on AVX2
+ * masks; everything else, and every instruction when AVX2 is not available, goes lane by lane through
+ * execute_instruction on a scratch emulator.
+ */
+#include "emulation.h"
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LOCKSTEP_AVX2 1
+#define AVX2 __attribute__((target("avx2")))
+#endif
+
+#define WORD 0
+#define BYTE 1
+#define FETCH_ADVANCE 2 //F0 moves the fetch address one word
+#define OPCODE_UNSET (-2) //decode leaves the opcode alone for words it does not recognise
+#define LANE_ON 0xFFFF
+#define VECTOR_ALIGN 32
+#define MAX_STOP_LEN 8
+#define LANE_ROWS (REGFILE_SIZE + 6) //registers, psw, execute_address, cpu_ops, last_word, waited, running
+
+/*
+ * @brief This function decodes the word at the group's address once for all the lanes executing it
+ * @return true if the word set the opcode, false if decode left it stale and each lane has to rebuild its own
+ */
+static bool decode_group_word(LockstepGroup *group, unsigned short address, unsigned short word)
+{
+    Emulator *scratch = group->scratch;
+    scratch->opcode = OPCODE_UNSET;
+    scratch->instruction_register = word;
+    scratch->decode_address = address;
+    decode_instruction(scratch);
+    return scratch->opcode != OPCODE_UNSET;
+}
+
+static void save_decode(const Emulator *scratch, LaneDecode *decode)
+{
+    decode->opcode = scratch->opcode;
+    decode->operand_bits = scratch->operand_bits;
+    decode->inst_operands = scratch->inst_operands;
+    decode->offset = scratch->offset;
+    decode->move_byte = scratch->move_byte;
+}
+
+static void restore_decode(Emulator *scratch, const LaneDecode *decode)
+{
+    scratch->opcode = decode->opcode;
+    scratch->operand_bits = decode->operand_bits;
+    scratch->inst_operands = decode->inst_operands;
+    scratch->offset = decode->offset;
+    scratch->move_byte = decode->move_byte;
+}
+
+static void halt_lane(LockstepGroup *group, unsigned int lane)
+{
+    group->state[lane] = LANE_HALTED;
+    group->running[lane] = 0;
+}
+
+static void evict_lane(LockstepGroup *group, unsigned int lane)
+{
+    group->state[lane] = LANE_EVICTED;
+    group->running[lane] = 0;
+    group->evictions++;
+}
+
+/*
+ * @brief This function halts a lane that has reached the stop address or the instruction limit, or gone to sleep
+ */
+static void check_lane_stop(LockstepGroup *group, unsigned int lane)
+{
+    if (group->execute_address[lane] == group->stop_address || (group->psw[lane] & PSW_S) ||
+        (group->instruction_limit != 0 && group->instructions[lane] >= group->instruction_limit))
+    {
+        halt_lane(group, lane);
+    }
+}
+
+/*
+ * @brief This function performs the E1 data access of a load or store on the lane's own D-memory, the same as
+ * memory_controller and execute_1 do on the global memory
+ */
+static void lane_memory_access(LockstepGroup *group, unsigned int lane)
+{
+    Emulator *scratch = group->scratch;
+    PagedMemory *memory = &group->data_memory[lane];
+    DataControlRegisters *control = &scratch->d_control;
+    switch (scratch->xCTRL)
+    {
+        case D_READ:
+            control->DMBR = paged_read_word(memory, control->DMAR);
+            break;
+        case D_READ_B:
+            control->DMBR = paged_read_byte(memory, control->DMAR);
+            break;
+        case D_WRITE:
+            paged_write_word(memory, control->DMAR, control->DMBR);
+            break;
+        case D_WRITE_B:
+            paged_write_byte(memory, control->DMAR, control->DMBR);
+            break;
+        default:
+            break;
+    }
+    if (scratch->opcode == ld || scratch->opcode == ldr)
+    {
+        scratch->reg_file[REGISTER][scratch->inst_operands.dest].word = control->DMBR;
+    }
+}
+
+/*
+ * @brief This function executes one instruction for one lane through execute_instruction, swapping the lane's
+ * registers into the scratch emulator around the call
+ * @param regular true if the group decode in the scratch emulator applies, false if the word leaves the opcode
+ * stale, in which case the stale decode state this lane's own history left behind is rebuilt first
+ */
+static void scalar_lane_step(LockstepGroup *group, unsigned int lane, unsigned short address, unsigned short word,
+                             bool regular)
+{
+    Emulator *scratch = group->scratch;
+    unsigned short view;
+    unsigned short fetch;
+    bool flushed;
+
+    if (!regular)
+    {
+        if (group->snapshot_at[lane] == group->instructions[lane])
+        {
+            //the instruction before was one of these too, its decode state is not just its word's
+            restore_decode(scratch, &group->snapshots[lane]);
+        }
+        else
+        {
+            scratch->instruction_register = group->last_word[lane];
+            decode_instruction(scratch);
+        }
+        scratch->cpu_ops.byte = group->cpu_ops[lane];
+        scratch->instruction_register = word;
+        decode_instruction(scratch);
+    }
+    else if (scratch->opcode != setcc && scratch->opcode != clrcc)
+    {
+        //MOVL..MOVH fall through into SETCC with whatever CC bits the lane decoded last
+        scratch->cpu_ops.byte = group->cpu_ops[lane];
+    }
+    for (int reg = 0; reg < REGFILE_SIZE; ++reg)
+    {
+        scratch->reg_file[REGISTER][reg].word = group->reg_file[reg][lane];
+    }
+    view = group->reg_file[PROG_COUNTER][lane] + FETCH_ADVANCE;
+    scratch->reg_file[REGISTER][PROG_COUNTER].word = view;
+    if (regular && scratch->opcode == bl)
+    {
+        //BL writes the link register as it is decoded
+        scratch->reg_file[REGISTER][LINK_REG].word = address + FETCH_ADVANCE;
+    }
+    scratch->psw.word = group->psw[lane];
+    scratch->xCTRL = NO_ACCESS;
+    flushed = execute_instruction(scratch);
+    if (scratch->xCTRL != NO_ACCESS)
+    {
+        lane_memory_access(group, lane);
+    }
+    for (int reg = 0; reg < REGFILE_SIZE; ++reg)
+    {
+        group->reg_file[reg][lane] = scratch->reg_file[REGISTER][reg].word;
+    }
+    group->psw[lane] = scratch->psw.word;
+    group->cpu_ops[lane] = scratch->cpu_ops.byte;
+    group->instructions[lane]++;
+    if (regular)
+    {
+        group->last_word[lane] = word;
+    }
+    else
+    {
+        save_decode(scratch, &group->snapshots[lane]);
+        group->snapshot_at[lane] = group->instructions[lane];
+    }
+
+    fetch = group->reg_file[PROG_COUNTER][lane];
+    if (flushed)
+    {
+        group->execute_address[lane] = fetch;
+        group->reg_file[PROG_COUNTER][lane] = fetch + FETCH_ADVANCE;
+        group->bubbles[lane]++;
+        if (scratch->opcode <= bra && fetch == address)
+        {
+            halt_lane(group, lane);
+            return;
+        }
+    }
+    else
+    {
+        group->execute_address[lane] = view - FETCH_ADVANCE;
+    }
+    check_lane_stop(group, lane);
+}
+
+/*
+ * @brief This function runs one group step lane by lane, counting the wait of lanes at other addresses
+ */
+static void scalar_group_step(LockstepGroup *group, unsigned short address, unsigned short word, bool regular)
+{
+    for (unsigned int lane = 0; lane < group->lanes; ++lane)
+    {
+        if (!group->running[lane])
+        {
+            continue;
+        }
+        if (group->execute_address[lane] == address)
+        {
+            group->waited[lane] = 0;
+            scalar_lane_step(group, lane, address, word, regular);
+        }
+        else if (++group->waited[lane] > LOCKSTEP_DIVERGENCE_LIMIT)
+        {
+            evict_lane(group, lane);
+        }
+    }
+}
+
+/*
+ * @brief the lowest address a running lane is waiting at, -1 once none are running
+ */
+static int scalar_group_address(const LockstepGroup *group)
+{
+    int lowest = -1;
+    for (unsigned int lane = 0; lane < group->lanes; ++lane)
+    {
+        if (group->running[lane] && (lowest < 0 || group->execute_address[lane] < lowest))
+        {
+            lowest = group->execute_address[lane];
+        }
+    }
+    return lowest;
+}
+
+#ifdef LOCKSTEP_AVX2
+static bool vector_opcode(OPCODES opcode)
+{
+    return opcode <= bra || (opcode >= add && opcode <= bis && opcode != dadd) || opcode == mov ||
+           opcode == setcc || opcode == clrcc || (opcode >= movl && opcode <= movh);
+}
+
+AVX2 static inline __m256i load_row(const unsigned short *row, unsigned int base)
+{
+    return _mm256_load_si256((const __m256i *)(row + base));
+}
+
+AVX2 static inline void store_row(unsigned short *row, unsigned int base, __m256i value)
+{
+    _mm256_store_si256((__m256i *)(row + base), value);
+}
+
+//a 16 bit lane mask, set where the bit under msb is set in value
+AVX2 static inline __m256i msb_set(__m256i value, __m256i msb)
+{
+    return _mm256_cmpeq_epi16(_mm256_and_si256(value, msb), msb);
+}
+
+AVX2 static inline __m256i flag(__m256i lane_mask, unsigned short psw_bit)
+{
+    return _mm256_and_si256(lane_mask, _mm256_set1_epi16((short)psw_bit));
+}
+
+/*
+ * @brief 1 << (source & 31) in every lane, cut to 16 bits, the AVX2 variable shifts only come in 32 bit lanes
+ */
+AVX2 static __m256i bit_masks(__m256i source)
+{
+    const __m256i ones = _mm256_set1_epi32(1);
+    const __m256i low_half = _mm256_set1_epi32(0xFFFF);
+    __m256i counts = _mm256_and_si256(source, _mm256_set1_epi16(31));
+    __m256i low = _mm256_sllv_epi32(ones, _mm256_cvtepu16_epi32(_mm256_castsi256_si128(counts)));
+    __m256i high = _mm256_sllv_epi32(ones, _mm256_cvtepu16_epi32(_mm256_extracti128_si256(counts, 1)));
+    __m256i packed = _mm256_packus_epi32(_mm256_and_si256(low, low_half), _mm256_and_si256(high, low_half));
+    //packus interleaves the 128 bit halves
+    return _mm256_permute4x64_epi64(packed, 0xD8);
+}
+
+/*
+ * @brief This function is the vector form of the ALU kernels, the result keeps the 16 bit intermediate so Z
+ * matches for byte operations
+ * @param flags set to the N, Z, C and V bits in PSW positions, the caller masks them with alu_flag_masks
+ */
+AVX2 static __m256i vector_alu(OPCODES opcode, unsigned char wb, __m256i dest, __m256i source, __m256i psw,
+                               __m256i *flags)
+{
+    const __m256i msb = _mm256_set1_epi16(wb == WORD ? (short)WORD_MSb : BYTE_MSb);
+    __m256i carry = _mm256_and_si256(psw, _mm256_set1_epi16(PSW_C));
+    __m256i result;
+    __m256i s;
+    __m256i carry_bits;
+    __m256i overflow_bits;
+
+    if (wb == BYTE)
+    {
+        dest = _mm256_and_si256(dest, _mm256_set1_epi16(0xFF));
+        source = _mm256_and_si256(source, _mm256_set1_epi16(0xFF));
+    }
+    switch (opcode)
+    {
+        case add:
+            result = _mm256_add_epi16(dest, source);
+            break;
+        case addc:
+            result = _mm256_add_epi16(_mm256_add_epi16(dest, source), carry);
+            break;
+        case subc:
+            result = _mm256_add_epi16(_mm256_sub_epi16(dest, source), carry);
+            break;
+        case xor:
+            result = _mm256_xor_si256(dest, source);
+            break;
+        case and:
+            result = _mm256_and_si256(dest, source);
+            break;
+        case or:
+            result = _mm256_or_si256(dest, source);
+            break;
+        case bit:
+            result = _mm256_and_si256(dest, bit_masks(source));
+            break;
+        case bic:
+            result = _mm256_andnot_si256(bit_masks(source), dest);
+            break;
+        case bis:
+            result = _mm256_or_si256(dest, bit_masks(source));
+            break;
+        default: //sub and cmp
+            result = _mm256_sub_epi16(dest, source);
+            break;
+    }
+    *flags = _mm256_or_si256(flag(msb_set(result, msb), PSW_N),
+                             flag(_mm256_cmpeq_epi16(result, _mm256_setzero_si256()), PSW_Z));
+    if (opcode <= cmp)
+    {
+        //C and V from the sign bits as msb_cv_flags in alu.c takes them, the source complemented for subtraction
+        s = opcode >= sub ? _mm256_xor_si256(source, _mm256_set1_epi16(-1)) : source;
+        carry_bits = _mm256_or_si256(_mm256_and_si256(s, dest),
+                                     _mm256_andnot_si256(result, _mm256_or_si256(s, dest)));
+        overflow_bits = _mm256_or_si256(_mm256_andnot_si256(result, _mm256_and_si256(s, dest)),
+                                        _mm256_andnot_si256(_mm256_or_si256(s, dest), result));
+        *flags = _mm256_or_si256(*flags, _mm256_or_si256(flag(msb_set(carry_bits, msb), PSW_C),
+                                                         flag(msb_set(overflow_bits, msb), PSW_V)));
+    }
+    return result;
+}
+
+/*
+ * @brief a lane mask of the lanes whose PSW satisfies the branch condition
+ */
+AVX2 static __m256i vector_condition(OPCODES opcode, __m256i psw)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i z = _mm256_cmpgt_epi16(_mm256_and_si256(psw, _mm256_set1_epi16(PSW_Z)), zero);
+    __m256i c = _mm256_cmpgt_epi16(_mm256_and_si256(psw, _mm256_set1_epi16(PSW_C)), zero);
+    __m256i n = _mm256_cmpgt_epi16(_mm256_and_si256(psw, _mm256_set1_epi16(PSW_N)), zero);
+    __m256i v = _mm256_cmpgt_epi16(_mm256_and_si256(psw, _mm256_set1_epi16(PSW_V)), zero);
+    switch (opcode)
+    {
+        case beq_bz:
+            return z;
+        case bne_bnz:
+            return _mm256_cmpeq_epi16(z, zero);
+        case bc_bhs:
+            return c;
+        case bnc_blo:
+            return _mm256_cmpeq_epi16(c, zero);
+        case bn:
+            return n;
+        case bge:
+            return _mm256_cmpeq_epi16(n, v);
+        case blt:
+            return _mm256_xor_si256(n, v);
+        default: //bra and bl
+            return _mm256_set1_epi16(-1);
+    }
+}
+
+/*
+ * @brief adds one to the 32 bit counters of the lanes set in the 16 bit lane mask
+ */
+AVX2 static inline void count_lanes(unsigned int *counters, unsigned int base, __m256i lane_mask)
+{
+    __m256i *low = (__m256i *)(counters + base);
+    __m256i *high = (__m256i *)(counters + base + LOCKSTEP_VECTOR_LANES / 2);
+    //a set lane is -1, so subtracting the widened mask counts it
+    _mm256_store_si256(low, _mm256_sub_epi32(_mm256_load_si256(low),
+                                             _mm256_cvtepi16_epi32(_mm256_castsi256_si128(lane_mask))));
+    _mm256_store_si256(high, _mm256_sub_epi32(_mm256_load_si256(high),
+                                              _mm256_cvtepi16_epi32(_mm256_extracti128_si256(lane_mask, 1))));
+}
+
+//calls action for every lane set in the 16 bit lane mask
+#define FOR_EACH_LANE(lane_mask, base, lane, action) \
+    do { \
+        unsigned int lane_bits = (unsigned int)_mm256_movemask_epi8(lane_mask); \
+        while (lane_bits) \
+        { \
+            unsigned int lane = (base) + __builtin_ctz(lane_bits) / 2; \
+            action; \
+            lane_bits &= lane_bits - 1; \
+            lane_bits &= lane_bits - 1; \
+        } \
+    } while (0)
+
+/*
+ * @brief This function executes the decoded instruction for every lane at the address, sixteen lanes at a time
+ */
+AVX2 static void vector_group_step(LockstepGroup *group, unsigned short address, unsigned short word)
+{
+    const Emulator *scratch = group->scratch;
+    const OPCODES opcode = scratch->opcode;
+    const operands ops = scratch->inst_operands;
+    const unsigned char flag_mask = opcode >= add && opcode <= bis ? alu_flag_masks[opcode - add] : 0;
+    const bool writes_dest = opcode != cmp && opcode != bit;
+    const bool check_limit = group->instruction_limit != 0 && group->group_steps >= group->instruction_limit;
+    const __m256i address_v = _mm256_set1_epi16((short)address);
+    const bool check_stop = group->stop_address != LOCKSTEP_NO_STOP;
+    const __m256i stop_v = _mm256_set1_epi16((short)group->stop_address);
+    const __m256i advance = _mm256_set1_epi16(FETCH_ADVANCE);
+    const __m256i one = _mm256_set1_epi16(1);
+    const __m256i wait_limit = _mm256_set1_epi16(LOCKSTEP_DIVERGENCE_LIMIT);
+    unsigned short *dest_row = group->reg_file[ops.dest];
+    __m256i running, active, waited, fetch, view, psw, dest, source, result, flags, taken, flushed, next;
+    __m256i halting;
+
+    for (unsigned int base = 0; base < group->padded_lanes; base += LOCKSTEP_VECTOR_LANES)
+    {
+        running = load_row(group->running, base);
+        active = _mm256_and_si256(_mm256_cmpeq_epi16(load_row(group->execute_address, base), address_v), running);
+        waited = _mm256_andnot_si256(active, _mm256_adds_epu16(load_row(group->waited, base),
+                                                               _mm256_and_si256(running, one)));
+        store_row(group->waited, base, waited);
+        if (!_mm256_testz_si256(_mm256_cmpgt_epi16(waited, wait_limit), running))
+        {
+            FOR_EACH_LANE(_mm256_and_si256(_mm256_cmpgt_epi16(waited, wait_limit), running), base, lane,
+                          evict_lane(group, lane));
+        }
+        if (_mm256_testz_si256(active, active))
+        {
+            continue;
+        }
+        //the executing instruction sees R7 one word past the fetch address
+        fetch = load_row(group->reg_file[PROG_COUNTER], base);
+        view = _mm256_add_epi16(fetch, advance);
+        store_row(group->reg_file[PROG_COUNTER], base, _mm256_blendv_epi8(fetch, view, active));
+        psw = load_row(group->psw, base);
+        taken = _mm256_setzero_si256();
+
+        switch (opcode)
+        {
+            case bl ... bra:
+                if (opcode == bl)
+                {
+                    store_row(group->reg_file[LINK_REG], base,
+                              _mm256_blendv_epi8(load_row(group->reg_file[LINK_REG], base),
+                                                 _mm256_set1_epi16((short)(address + FETCH_ADVANCE)), active));
+                }
+                taken = _mm256_and_si256(vector_condition(opcode, psw), active);
+                store_row(group->reg_file[PROG_COUNTER], base,
+                          _mm256_add_epi16(load_row(group->reg_file[PROG_COUNTER], base),
+                                           _mm256_and_si256(taken, _mm256_set1_epi16(scratch->offset))));
+                break;
+            case add ... bis:
+                dest = load_row(dest_row, base);
+                source = ops.register_or_constant == CONSTANT
+                         ? _mm256_set1_epi16((short)scratch->reg_file[CONSTANT][ops.source_const].word)
+                         : load_row(group->reg_file[ops.source_const], base);
+                result = vector_alu(opcode, ops.word_or_byte, dest, source, psw, &flags);
+                if (writes_dest)
+                {
+                    if (ops.word_or_byte == BYTE)
+                    {
+                        result = _mm256_or_si256(_mm256_and_si256(dest, _mm256_set1_epi16((short)0xFF00)),
+                                                 _mm256_and_si256(result, _mm256_set1_epi16(0xFF)));
+                    }
+                    store_row(dest_row, base, _mm256_blendv_epi8(dest, result, active));
+                }
+                psw = _mm256_or_si256(_mm256_andnot_si256(_mm256_set1_epi16(flag_mask), psw),
+                                      _mm256_and_si256(flags, _mm256_set1_epi16(flag_mask)));
+                store_row(group->psw, base, _mm256_blendv_epi8(load_row(group->psw, base), psw, active));
+                break;
+            case mov:
+                source = load_row(group->reg_file[ops.source_const], base);
+                store_row(dest_row, base, _mm256_blendv_epi8(load_row(dest_row, base), source, active));
+                break;
+            case movl ... movh:
+                dest = load_row(dest_row, base);
+                switch (opcode)
+                {
+                    case movl:
+                        result = _mm256_or_si256(_mm256_and_si256(dest, _mm256_set1_epi16((short)0xFF00)),
+                                                 _mm256_set1_epi16(scratch->move_byte));
+                        break;
+                    case movlz:
+                        result = _mm256_set1_epi16(scratch->move_byte);
+                        break;
+                    case movls:
+                        result = _mm256_set1_epi16((short)(0xFF00 | scratch->move_byte));
+                        break;
+                    default:
+                        result = _mm256_or_si256(_mm256_and_si256(dest, _mm256_set1_epi16(0xFF)),
+                                                 _mm256_set1_epi16((short)(scratch->move_byte << 8)));
+                        break;
+                }
+                store_row(dest_row, base, _mm256_blendv_epi8(dest, result, active));
+                //falls through into SETCC with each lane's last CC bits
+                store_row(group->psw, base,
+                          _mm256_blendv_epi8(psw, _mm256_or_si256(psw, load_row(group->cpu_ops, base)), active));
+                break;
+            case setcc:
+            case clrcc:
+                flags = _mm256_set1_epi16(scratch->cpu_ops.byte);
+                psw = opcode == setcc ? _mm256_or_si256(psw, flags) : _mm256_andnot_si256(flags, psw);
+                store_row(group->psw, base, _mm256_blendv_epi8(load_row(group->psw, base), psw, active));
+                store_row(group->cpu_ops, base, _mm256_blendv_epi8(load_row(group->cpu_ops, base), flags, active));
+                break;
+            default:
+                break;
+        }
+
+        //flush the lanes whose R7 moved or whose branch was taken, the rest carry on with the fetched word
+        fetch = load_row(group->reg_file[PROG_COUNTER], base);
+        flushed = _mm256_or_si256(_mm256_andnot_si256(_mm256_cmpeq_epi16(fetch, view), active), taken);
+        next = _mm256_blendv_epi8(_mm256_sub_epi16(view, advance), fetch, flushed);
+        store_row(group->execute_address, base,
+                  _mm256_blendv_epi8(load_row(group->execute_address, base), next, active));
+        store_row(group->reg_file[PROG_COUNTER], base,
+                  _mm256_blendv_epi8(fetch, _mm256_add_epi16(fetch, advance), flushed));
+        store_row(group->last_word, base,
+                  _mm256_blendv_epi8(load_row(group->last_word, base), _mm256_set1_epi16((short)word), active));
+        count_lanes(group->instructions, base, active);
+        count_lanes(group->bubbles, base, flushed);
+
+        if (opcode <= bra)
+        {
+            halting = _mm256_and_si256(_mm256_cmpeq_epi16(next, address_v), flushed);
+            FOR_EACH_LANE(halting, base, lane, halt_lane(group, lane));
+        }
+        if (opcode == setcc || (opcode >= movl && opcode <= movh))
+        {
+            //SETCC, and MOVL..MOVH falling through into it, can set the sleep bit, nothing wakes the lane again
+            halting = _mm256_and_si256(load_row(group->psw, base), _mm256_set1_epi16(PSW_S));
+            halting = _mm256_andnot_si256(_mm256_cmpeq_epi16(halting, _mm256_setzero_si256()), active);
+            FOR_EACH_LANE(halting, base, lane, halt_lane(group, lane));
+        }
+        halting = check_limit ? active : _mm256_and_si256(_mm256_cmpeq_epi16(next, stop_v), active);
+        if ((check_limit || check_stop) && !_mm256_testz_si256(halting, halting))
+        {
+            FOR_EACH_LANE(halting, base, lane, check_lane_stop(group, lane));
+        }
+    }
+}
+
+AVX2 static int vector_group_address(const LockstepGroup *group)
+{
+    __m256i lowest = _mm256_set1_epi16(-1);
+    __m256i any_running = _mm256_setzero_si256();
+    __m256i running;
+    __m128i halves;
+    for (unsigned int base = 0; base < group->padded_lanes; base += LOCKSTEP_VECTOR_LANES)
+    {
+        running = load_row(group->running, base);
+        lowest = _mm256_min_epu16(lowest, _mm256_blendv_epi8(lowest, load_row(group->execute_address, base), running));
+        any_running = _mm256_or_si256(any_running, running);
+    }
+    if (_mm256_testz_si256(any_running, any_running))
+    {
+        return -1;
+    }
+    halves = _mm_min_epu16(_mm256_castsi256_si128(lowest), _mm256_extracti128_si256(lowest, 1));
+    return (unsigned short)_mm_cvtsi128_si32(_mm_minpos_epu16(halves));
+}
+#endif
+
+/*
+ * @brief This function finishes an evicted lane on its own with the scalar path
+ */
+static void run_evicted_lane(LockstepGroup *group, unsigned int lane)
+{
+    unsigned short address;
+    unsigned short word;
+    bool regular;
+    while (!stop_loop && group->state[lane] == LANE_EVICTED)
+    {
+        address = group->execute_address[lane];
+        word = xm23_memory[I_MEMORY].word[address >> 1];
+        regular = decode_group_word(group, address, word);
+        scalar_lane_step(group, lane, address, word, regular);
+    }
+}
+
+/*
+ * @brief This function creates a group of lanes that all start at the start address with cleared registers and a
+ * copy on write view of the loaded D-memory, callers set each lane's inputs through reg_file, psw and the paged
+ * writes on data_memory before running
+ * @return the group, or NULL if it could not be allocated
+ */
+LockstepGroup *create_lockstep_group(unsigned int lanes, unsigned short start_address)
+{
+    LockstepGroup *group = calloc(1, sizeof(LockstepGroup));
+    unsigned int padded = (lanes + LOCKSTEP_VECTOR_LANES - 1) / LOCKSTEP_VECTOR_LANES * LOCKSTEP_VECTOR_LANES;
+    unsigned short *rows;
+    if (group == NULL || lanes == 0)
+    {
+        free(group);
+        return NULL;
+    }
+    group->lanes = lanes;
+    group->padded_lanes = padded;
+    rows = aligned_alloc(VECTOR_ALIGN, LANE_ROWS * padded * sizeof(unsigned short));
+    group->instructions = aligned_alloc(VECTOR_ALIGN, padded * sizeof(unsigned int));
+    group->bubbles = aligned_alloc(VECTOR_ALIGN, padded * sizeof(unsigned int));
+    group->snapshot_at = calloc(padded, sizeof(unsigned int));
+    group->snapshots = calloc(padded, sizeof(LaneDecode));
+    group->state = malloc(padded);
+    group->data_memory = calloc(lanes, sizeof(PagedMemory));
+    group->data_image = create_page_image(&xm23_memory[D_MEMORY]);
+    group->scratch = calloc(1, sizeof(Emulator));
+    if (rows == NULL || group->instructions == NULL || group->bubbles == NULL || group->snapshot_at == NULL ||
+        group->snapshots == NULL || group->state == NULL || group->data_memory == NULL ||
+        group->data_image == NULL || group->scratch == NULL)
+    {
+        group->reg_file[0] = rows;
+        free_lockstep_group(group);
+        return NULL;
+    }
+    memset(rows, 0, LANE_ROWS * padded * sizeof(unsigned short));
+    for (int reg = 0; reg < REGFILE_SIZE; ++reg)
+    {
+        group->reg_file[reg] = rows + reg * padded;
+    }
+    group->psw = rows + REGFILE_SIZE * padded;
+    group->execute_address = group->psw + padded;
+    group->cpu_ops = group->execute_address + padded;
+    group->last_word = group->cpu_ops + padded;
+    group->waited = group->last_word + padded;
+    group->running = group->waited + padded;
+    memset(group->instructions, 0, padded * sizeof(unsigned int));
+    memset(group->bubbles, 0, padded * sizeof(unsigned int));
+    init_emulator(group->scratch);
+    group->scratch->is_quiet = true;
+    group->stop_address = LOCKSTEP_NO_STOP;
+
+    for (unsigned int lane = 0; lane < padded; ++lane)
+    {
+        if (lane < lanes)
+        {
+            group->execute_address[lane] = start_address;
+            group->reg_file[PROG_COUNTER][lane] = start_address + FETCH_ADVANCE;
+            group->running[lane] = LANE_ON;
+            group->state[lane] = LANE_RUNNING;
+            group->bubbles[lane] = 1; //the fetch of the first word, as in the scalar pipeline
+            init_paged_memory(&group->data_memory[lane], group->data_image);
+        }
+        else
+        {
+            group->state[lane] = LANE_HALTED;
+        }
+    }
+#ifdef LOCKSTEP_AVX2
+    group->use_avx2 = __builtin_cpu_supports("avx2");
+#endif
+    return group;
+}
+
+void free_lockstep_group(LockstepGroup *group)
+{
+    if (group == NULL)
+    {
+        return;
+    }
+    free(group->reg_file[0]);
+    free(group->instructions);
+    free(group->bubbles);
+    free(group->snapshot_at);
+    free(group->snapshots);
+    free(group->state);
+    if (group->data_memory != NULL)
+    {
+        for (unsigned int lane = 0; lane < group->lanes; ++lane)
+        {
+            free_paged_memory(&group->data_memory[lane]);
+        }
+    }
+    free(group->data_memory);
+    free_page_image(group->data_image);
+    if (group->scratch != NULL)
+    {
+        free(group->scratch->branch_profile);
+        free(group->scratch);
+    }
+    free(group);
+}
+
+/*
+ * @brief This function runs every lane until it halts, is evicted, or ctrl-c is pressed, then finishes the
+ * evicted lanes one at a time
+ */
+void run_lockstep(LockstepGroup *group)
+{
+    Emulator *scratch = group->scratch;
+    int address;
+    unsigned short word;
+    bool regular;
+
+    for (unsigned int lane = 0; lane < group->lanes; ++lane)
+    {
+        if (group->state[lane] == LANE_RUNNING)
+        {
+            check_lane_stop(group, lane);
+        }
+    }
+    while (!stop_loop)
+    {
+#ifdef LOCKSTEP_AVX2
+        address = group->use_avx2 ? vector_group_address(group) : scalar_group_address(group);
+#else
+        address = scalar_group_address(group);
+#endif
+        if (address < 0)
+        {
+            break;
+        }
+        word = xm23_memory[I_MEMORY].word[address >> 1];
+        regular = decode_group_word(group, address, word);
+        group->group_steps++;
+#ifdef LOCKSTEP_AVX2
+        if (group->use_avx2 && regular && vector_opcode(scratch->opcode))
+        {
+            vector_group_step(group, address, word);
+            group->vector_steps++;
+            continue;
+        }
+#endif
+        scalar_group_step(group, address, word, regular);
+    }
+    for (unsigned int lane = 0; lane < group->lanes; ++lane)
+    {
+        run_evicted_lane(group, lane);
+    }
+}
+
+/*
+ * @brief This function runs the loaded program once per lane with one register swept across the lanes, starting
+ * from the emulator's registers and PSW, and prints each lane's result
+ */
+void lockstep_sweep(Emulator *emulator)
+{
+    LockstepGroup *group;
+    unsigned int lanes;
+    unsigned int reg;
+    unsigned int start;
+    unsigned int step;
+    char stop[MAX_STOP_LEN];
+    unsigned long int total = 0;
+    unsigned long int copied = 0;
+    double seconds;
+    struct timespec begin;
+    struct timespec end;
+
+    if (!emulator->is_memset)
+    {
+        printf("No file loaded, cannot run a sweep\n");
+        return;
+    }
+    printf("Enter number of instances: ");
+    if (scanf("%u", &lanes) != 1 || lanes == 0)
+    {
+        printf("Invalid number of instances\n");
+        return;
+    }
+    printf("Enter register to sweep (0-6): R");
+    if (scanf("%u", &reg) != 1 || reg >= PROG_COUNTER)
+    {
+        printf("Invalid register\n");
+        return;
+    }
+    printf("Enter first value and step (hex): ");
+    if (scanf("%x %x", &start, &step) != 2)
+    {
+        printf("Invalid values\n");
+        return;
+    }
+    printf("Enter stop address (hex, N to run to a branch to itself): ");
+    if (scanf("%7s", stop) != 1 || (tolower(stop[0]) != 'n' && !isxdigit(stop[0])))
+    {
+        printf("Invalid address\n");
+        return;
+    }
+    group = create_lockstep_group(lanes, emulator->starting_address);
+    if (group == NULL)
+    {
+        printf("Could not allocate %u instances\n", lanes);
+        return;
+    }
+    group->stop_address = tolower(stop[0]) == 'n' ? LOCKSTEP_NO_STOP : (int)(strtoul(stop, NULL, 16) & 0xFFFF);
+    group->instruction_limit = emulator->clock_limit / 2;
+    for (unsigned int lane = 0; lane < lanes; ++lane)
+    {
+        for (int r = 0; r < PROG_COUNTER; ++r)
+        {
+            group->reg_file[r][lane] = emulator->reg_file[REGISTER][r].word;
+        }
+        group->reg_file[reg][lane] = start + lane * step;
+        group->psw[lane] = emulator->psw.word;
+    }
+
+    //ctrl-c ends the sweep, the lanes still running are reported as interrupted
+    stop_loop = 0;
+    signal(SIGINT, int_handler);
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    run_lockstep(group);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    seconds = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9;
+
+    printf("Lane  R%u     R0   R1   R2   R3   R4   R5   R6   PC   PSW  Instructions\n", reg);
+    for (unsigned int lane = 0; lane < lanes; ++lane)
+    {
+        printf("%-5u %04X  ", lane, (start + lane * step) & 0xFFFF);
+        for (int r = 0; r < PROG_COUNTER; ++r)
+        {
+            printf(" %04X", group->reg_file[r][lane]);
+        }
+        printf(" %04X %04X %u%s\n", group->execute_address[lane], group->psw[lane], group->instructions[lane],
+               group->state[lane] == LANE_HALTED ? "" : " (interrupted)");
+        total += group->instructions[lane];
+        copied += group->data_memory[lane].copied_pages;
+    }
+    printf("%lu instructions in %.3f s (%.2f MIPS), %lu group steps, %lu on AVX2, %lu lanes evicted\n", total,
+           seconds, seconds > 0 ? total / seconds / 1e6 : 0.0, group->group_steps, group->vector_steps,
+           group->evictions);
+    printf("D-memory: %u shared pages, %lu pages copied on write (%lu KB instead of %lu KB)\n",
+           group->data_image->stored_pages, copied,
+           ((group->data_image->stored_pages + 1 + copied) * PAGE_SIZE + lanes * sizeof(PagedMemory)) / 1024,
+           lanes * sizeof(Memory) / 1024);
+    free_lockstep_group(group);
+}
@@ -5,30 +5,414 @@
  * Module Info: This module defines global vars, adds support for launching
  * the program with an initial xme file, and then calls menu
  *
+ * Command line options run the emulator headless for job scripts, loading the file, running it and dumping the
+ * results without the menu. A script file replaces the keyboard with menu commands read from the file.
+ * Usage: Assignment2_Debugging [-q] [-c clocks] [-b breakpoint] [-r] [-m lower:upper:I|D]...
+ *        [-e lower:upper:I|D:H|R|S:file]... [-d I|D:image]... [-v coverage] [-l listing.lis] [-y listing.lis]
+ *        [-p folded.txt] [-t per_second | -k clocks] [-a I|D:size:ways:line:B|T:penalty]... [-x] [-f] [-i]
+ *        [-s script] [-g port|socket] [-u socket] [file.xme]
+ *   -q  quiet, no pipeline trace or loader messages
+ *   -c  stop after this many clocks
+ *   -b  stop after the instruction at this .LIS label or address (hex), which also serves as run to PC
+ *   -r  print the registers and PSW after the run
+ *   -m  print a memory range after the run (hex), may be given more than once
+ *   -e  write a memory range to a file after the run as a hex dump, raw binary or S-records, may be given more than once
+ *   -d  compare a bank with a raw image after the run and exit with 2 if they differ, may be given more than once
+ *   -v  record coverage and OR it into this bitmap file after the run, so batch runs accumulate in one file
+ *   -l  print coverage against this .lis listing after the run, merged with the -v file if given
+ *   -y  take symbols from this listing instead of the .lis next to the .xme file
+ *   -p  profile calls, print the functions after the run and write their folded stacks to this file
+ *   -t  sample the PC this many times a second of host CPU time and print the hottest code after the run
+ *   -k  sample the PC about every this many clocks instead
+ *   -a  simulate an I or D cache, write back (B) or through (T), and report its misses with the statistics
+ *   -x  profile D-memory accesses and print the busiest lines, load/store strides and reuse distances after the run
+ *   -f  map the performance counter device at the top of D-memory so the program can time itself with LD
+ *   -i  run branches to themselves up to the clock limit in one step instead of halting on them
+ *   -s  run the menu with commands read from the script instead of running headless
+ *   -g  serve a GDB debugger on a localhost port or Unix socket instead of running headless
+ *   -u  serve binary control protocol sessions on a Unix socket, no file is needed
  */
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <unistd.h>
+#include <fcntl.h>
 
 #include "emulation.h"
 #include "loader.h"
 
-Memory xm23_memory[2];
+#define MAX_DUMPS 16
+#define MAX_DIFFS 2
+#define DIFF_FOUND_STATUS 2
+
+static Memory emulator_memory[2];
+Memory *xm23_memory = emulator_memory;
 FILE* input_file;
 
+typedef struct memory_dump
+{
+    int lower;
+    int upper;
+    int mem_type;
+    EXPORT_FORMATS format;
+    char *file_name; //NULL prints to stdout
+}MemoryDump;
+
+static void print_usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-q] [-c clocks] [-b breakpoint] [-r] [-m lower:upper:I|D]... "
+                    "[-e lower:upper:I|D:H|R|S:file]... [-d I|D:image]... [-v coverage] [-l listing.lis] [-y listing.lis] "
+                    "[-p folded.txt] [-t per_second | -k clocks] [-a I|D:size:ways:line:B|T:penalty]... [-x] "
+                    "[-f] [-i] [-s script] [-g port|socket] [-u socket] [file.xme]\n", name);
+}
+
+/*
+ * @brief This function parses a memory range in the form lower:upper:I or lower:upper:D
+ * @return true if the range was valid
+ */
+static bool parse_dump(const char *range, MemoryDump *dump)
+{
+    char mem_type;
+    if (sscanf(range, "%x:%x:%c", &dump->lower, &dump->upper, &mem_type) != 3 ||
+        (toupper(mem_type) != 'I' && toupper(mem_type) != 'D'))
+    {
+        return false;
+    }
+    dump->mem_type = toupper(mem_type) == 'I' ? INSTR : DATA;
+    dump->format = EXPORT_HEX_DUMP;
+    dump->file_name = NULL;
+    return true;
+}
+
+/*
+ * @brief This function parses an export in the form lower:upper:I|D:H|R|S:file
+ * @return true if the export was valid
+ */
+static bool parse_export(char *export, MemoryDump *dump)
+{
+    char *format = strchr(export, ':');
+    format = format == NULL ? NULL : strchr(format + 1, ':');
+    format = format == NULL ? NULL : strchr(format + 1, ':');
+    if (format == NULL || !parse_dump(export, dump) || format[1] == '\0' || format[2] != ':' || format[3] == '\0' ||
+        dump->lower < 0 || dump->upper > (BYTE_MEMORY_SIZE) || dump->lower > dump->upper)
+    {
+        return false;
+    }
+    switch (toupper(format[1]))
+    {
+        case 'H':
+            dump->format = EXPORT_HEX_DUMP;
+            break;
+        case 'R':
+            dump->format = EXPORT_RAW;
+            break;
+        case 'S':
+            dump->format = EXPORT_S_RECORDS;
+            break;
+        default:
+            return false;
+    }
+    dump->file_name = format + 3;
+    return true;
+}
+
 int main(int argc, char* argv[]) {
     Emulator *new_emulator = calloc(1, sizeof(Emulator));
-    //support for dragging a file onto the executable to start the program
+    MemoryDump dumps[MAX_DUMPS];
+    int dump_count = 0;
+    char *breakpoint_text = NULL;
+    int breakpoint;
+    char *symbols_path = NULL;
+    char *folded_path = NULL;
+    FILE *folded;
+    SAMPLE_TRIGGERS sample_trigger = SAMPLE_HOST_TIMER;
+    unsigned long int sample_period = 0;
+    CacheConfig cache_config;
+    bool profile_accesses = false;
+    bool headless = false;
+    bool print_state = false;
+    char *script = NULL;
+    char *gdb_address = NULL;
+    char *control_path = NULL;
+    int option;
+    int export_fd;
+    int diff_types[MAX_DIFFS];
+    char *diff_images[MAX_DIFFS];
+    int diff_count = 0;
+    int diff_ranges;
+    int status = 0;
+    char *coverage_path = NULL;
+    char *listing_path = NULL;
+
     init_emulator(new_emulator);
-    if (argc > 1)
+    while ((option = getopt(argc, argv, "qc:b:rm:e:d:v:l:y:p:t:k:a:xfis:g:u:")) != -1)
     {
-        printf("File provided to loader (%s), loading now..\n", argv[1]);
-        load(input_file, argv[1], new_emulator);
+        headless = true;
+        switch (option)
+        {
+            case 'q':
+                new_emulator->is_quiet = true;
+                break;
+            case 'c':
+                new_emulator->clock_limit = strtoul(optarg, NULL, 10);
+                break;
+            case 'b':
+                breakpoint_text = optarg;
+                break;
+            case 'r':
+                print_state = true;
+                break;
+            case 'm':
+                if (dump_count == MAX_DUMPS || !parse_dump(optarg, &dumps[dump_count]))
+                {
+                    fprintf(stderr, "Invalid memory range %s, expected lower:upper:I|D in hex\n", optarg);
+                    return 1;
+                }
+                dump_count++;
+                break;
+            case 'e':
+                if (dump_count == MAX_DUMPS || !parse_export(optarg, &dumps[dump_count]))
+                {
+                    fprintf(stderr, "Invalid export %s, expected lower:upper:I|D:H|R|S:file with the range in hex\n",
+                            optarg);
+                    return 1;
+                }
+                dump_count++;
+                break;
+            case 'd':
+                if (diff_count == MAX_DIFFS || (toupper(optarg[0]) != 'I' && toupper(optarg[0]) != 'D') ||
+                    optarg[1] != ':' || optarg[2] == '\0')
+                {
+                    fprintf(stderr, "Invalid diff %s, expected I|D:image\n", optarg);
+                    return 1;
+                }
+                diff_types[diff_count] = toupper(optarg[0]) == 'I' ? INSTR : DATA;
+                diff_images[diff_count++] = optarg + 2;
+                break;
+            case 'v':
+                coverage_path = optarg;
+                break;
+            case 'l':
+                listing_path = optarg;
+                break;
+            case 'y':
+                symbols_path = optarg;
+                break;
+            case 'p':
+                folded_path = optarg;
+                break;
+            case 't':
+                sample_trigger = SAMPLE_HOST_TIMER;
+                sample_period = strtoul(optarg, NULL, 10);
+                if (sample_period == 0 || sample_period > MICROSECONDS_PER_SECOND)
+                {
+                    fprintf(stderr, "Invalid sample rate %s\n", optarg);
+                    return 1;
+                }
+                sample_period = MICROSECONDS_PER_SECOND / sample_period;
+                break;
+            case 'k':
+                sample_trigger = SAMPLE_CLOCK_COUNT;
+                sample_period = strtoul(optarg, NULL, 10);
+                if (sample_period == 0)
+                {
+                    fprintf(stderr, "Invalid sample period %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'a':
+                if ((toupper(optarg[0]) != 'I' && toupper(optarg[0]) != 'D') || optarg[1] != ':' ||
+                    !parse_cache_config(optarg + 2, &cache_config) ||
+                    !add_cache(new_emulator, toupper(optarg[0]) == 'I' ? I_MEMORY : D_MEMORY, cache_config))
+                {
+                    fprintf(stderr, "Invalid cache %s, expected I|D:size:ways:line:B|T:penalty\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'x':
+                profile_accesses = true;
+                break;
+            case 'f':
+                new_emulator->perf_counters.mapped = true;
+                break;
+            case 'i':
+                new_emulator->idle.skip_loops = true;
+                break;
+            case 's':
+                script = optarg;
+                break;
+            case 'g':
+                gdb_address = optarg;
+                break;
+            case 'u':
+                control_path = optarg;
+                break;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    //support for dragging a file onto the executable to start the program
+    if (optind < argc)
+    {
+        if (!new_emulator->is_quiet) printf("File provided to loader (%s), loading now..\n", argv[optind]);
+        load(input_file, argv[optind], new_emulator);
+        load_listing_symbols(new_emulator, argv[optind]);
+        new_emulator->is_memset = true;
+    }
+    if (symbols_path != NULL)
+    {
+        free_symbols(new_emulator->symbols);
+        new_emulator->symbols = load_symbols(symbols_path);
+        if (new_emulator->symbols == NULL)
+        {
+            fprintf(stderr, "No symbols in %s\n", symbols_path);
+            return 1;
+        }
+    }
+    if ((coverage_path != NULL || listing_path != NULL) && !enable_coverage(new_emulator))
+    {
+        fprintf(stderr, "Could not allocate the coverage bitmap\n");
+        return 1;
+    }
+    if (folded_path != NULL && !enable_call_profile(new_emulator))
+    {
+        fprintf(stderr, "Could not allocate the call profile\n");
+        return 1;
+    }
+    if (profile_accesses && !enable_access_profile(new_emulator))
+    {
+        fprintf(stderr, "Could not allocate the access profile\n");
+        return 1;
+    }
+    if (sample_period != 0 && !enable_sampler(new_emulator, sample_trigger, sample_period))
+    {
+        fprintf(stderr, "Could not start sampling\n");
+        return 1;
+    }
+    if (breakpoint_text != NULL)
+    {
+        if (!parse_code_address(new_emulator, breakpoint_text, &breakpoint))
+        {
+            fprintf(stderr, "Invalid breakpoint %s, expected a label or a hex address\n", breakpoint_text);
+            return 1;
+        }
+        set_breakpoint_address(new_emulator, breakpoint);
+    }
+
+    if (control_path != NULL)
+    {
+        return run_control_server(control_path) == 0 ? 0 : 1;
+    }
+    if (script != NULL)
+    {
+        if (freopen(script, "r", stdin) == NULL)
+        {
+            fprintf(stderr, "Could not open script %s\n", script);
+            return 1;
+        }
+        new_emulator->hide_menu_prompt = true;
         menu(new_emulator);
     }
+    else if (gdb_address != NULL)
+    {
+        if (!new_emulator->is_memset)
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+        return run_gdb_server(new_emulator, gdb_address) == 0 ? 0 : 1;
+    }
+    else if (headless)
+    {
+        if (!new_emulator->is_memset)
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+        //a headless run ends at the first stop, single step is never on so breakpoints and ctrl-c end it too
+        report_stop(new_emulator, run_emulator(new_emulator, 0));
+        if (new_emulator->has_started)
+        {
+            print_statistics(new_emulator);
+        }
+        if (print_state)
+        {
+            print_registers(new_emulator);
+            print_psw(new_emulator, SINGLE_LINE);
+        }
+        for (int i = 0; i < dump_count; ++i)
+        {
+            if (dumps[i].file_name == NULL)
+            {
+                dump_memory(dumps[i].lower, dumps[i].upper, dumps[i].mem_type);
+                continue;
+            }
+            export_fd = open(dumps[i].file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (export_fd < 0 || !export_memory(export_fd, dumps[i].mem_type, dumps[i].lower, dumps[i].upper,
+                                                dumps[i].format, (unsigned short)new_emulator->starting_address))
+            {
+                fprintf(stderr, "Could not export to %s\n", dumps[i].file_name);
+            }
+            if (export_fd >= 0)
+            {
+                close(export_fd);
+            }
+        }
+        if (coverage_path != NULL && !accumulate_coverage(new_emulator->coverage, coverage_path))
+        {
+            fprintf(stderr, "Could not save coverage to %s\n", coverage_path);
+            status = 1;
+        }
+        if (listing_path != NULL)
+        {
+            print_coverage_report(new_emulator, listing_path);
+        }
+        if (sample_period != 0)
+        {
+            print_sample_report(new_emulator);
+        }
+        if (profile_accesses)
+        {
+            print_access_profile(new_emulator);
+        }
+        if (new_emulator->perf_counters.mapped)
+        {
+            print_perf_counters(new_emulator);
+        }
+        if (folded_path != NULL)
+        {
+            print_call_profile(new_emulator);
+            folded = fopen(folded_path, "w");
+            if (folded == NULL)
+            {
+                fprintf(stderr, "Could not write folded stacks to %s\n", folded_path);
+                status = 1;
+            }
+            else
+            {
+                write_folded_stacks(new_emulator, folded);
+                fclose(folded);
+            }
+        }
+        for (int i = 0; i < diff_count; ++i)
+        {
+            diff_ranges = diff_memory_image(diff_types[i], diff_images[i]);
+            if (diff_ranges < 0)
+            {
+                fprintf(stderr, "Could not read image %s\n", diff_images[i]);
+                status = 1;
+            }
+            else if (diff_ranges > 0 && status == 0)
+            {
+                status = DIFF_FOUND_STATUS;
+            }
+        }
+    }
     else
     {
         menu(new_emulator);
     }
-    return 0;
+    return status;
 }
@@ -0,0 +1,280 @@
+/*
+ * File Name: memory_diff.c
+ * Date October 19 2026
+ * Module Info: This module compares two memory images, or live memory against a saved snapshot or a raw image
+ * exported with -e ...:R, and reports the ranges that differ. Memory is compared 64 bytes at a time, two AVX2
+ * compares when the processor has them and eight 64 bit compares otherwise, giving a mask of the bytes that differ
+ * so equal memory costs a compare per chunk and only differing chunks are looked at byte by byte. A full 64 KB bank
+ * takes a few microseconds.
+ *
+ * Differing bytes less than DIFF_MERGE_GAP apart are grouped into one range, each range is reported with its size,
+ * the number of bytes that changed in it and its bytes before and after.
+ */
+#include "emulation.h"
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DIFF_AVX2 1
+#define AVX2 __attribute__((target("avx2")))
+#endif
+
+#define DIFF_CHUNK 64 //bytes covered by one difference mask
+#define DIFF_MAX_RANGES 256 //ranges printed, the rest are only counted
+
+typedef struct diff_scan
+{
+    DiffRange *ranges;
+    int max_ranges;
+    int count;
+    DiffRange current; //the range being grown, changed is 0 before the first difference
+}DiffScan;
+typedef void (*chunk_scanner)(const unsigned char *before, const unsigned char *after, int length, DiffScan *scan);
+
+static Memory snapshot[2];
+static bool snapshot_saved;
+
+static void close_range(DiffScan *scan)
+{
+    if (scan->count < scan->max_ranges)
+    {
+        scan->ranges[scan->count] = scan->current;
+    }
+    scan->count++;
+}
+
+/*
+ * @brief This function adds the differing bytes of one chunk, growing the last range or starting new ones
+ * @param mask bit n is set if byte n of the chunk at address differs
+ */
+static inline void add_differences(DiffScan *scan, int address, uint64_t mask)
+{
+    int difference;
+    while (mask != 0)
+    {
+        difference = address + __builtin_ctzll(mask);
+        mask &= mask - 1;
+        if (scan->current.changed > 0 && difference - scan->current.end < DIFF_MERGE_GAP)
+        {
+            scan->current.end = difference + 1;
+            scan->current.changed++;
+            continue;
+        }
+        if (scan->current.changed > 0)
+        {
+            close_range(scan);
+        }
+        scan->current.start = difference;
+        scan->current.end = difference + 1;
+        scan->current.changed = 1;
+    }
+}
+
+static void scalar_scan(const unsigned char *before, const unsigned char *after, int length, DiffScan *scan)
+{
+    uint64_t a;
+    uint64_t b;
+    uint64_t mask;
+    for (int address = 0; address + DIFF_CHUNK <= length; address += DIFF_CHUNK)
+    {
+        mask = 0;
+        for (int word = 0; word < DIFF_CHUNK; word += 8)
+        {
+            memcpy(&a, before + address + word, sizeof(a));
+            memcpy(&b, after + address + word, sizeof(b));
+            for (int byte = 0; a != b && byte < 8; ++byte)
+            {
+                mask |= (uint64_t)(before[address + word + byte] != after[address + word + byte]) << (word + byte);
+            }
+        }
+        add_differences(scan, address, mask);
+    }
+}
+
+#ifdef DIFF_AVX2
+AVX2 static void vector_scan(const unsigned char *before, const unsigned char *after, int length, DiffScan *scan)
+{
+    __m256i low;
+    __m256i high;
+    uint64_t equal;
+    for (int address = 0; address + DIFF_CHUNK <= length; address += DIFF_CHUNK)
+    {
+        low = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(before + address)),
+                                _mm256_loadu_si256((const __m256i *)(after + address)));
+        high = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(before + address + 32)),
+                                 _mm256_loadu_si256((const __m256i *)(after + address + 32)));
+        equal = (uint32_t)_mm256_movemask_epi8(low) | (uint64_t)(uint32_t)_mm256_movemask_epi8(high) << 32;
+        if (equal != UINT64_MAX)
+        {
+            add_differences(scan, address, ~equal);
+        }
+    }
+}
+#endif
+
+static chunk_scanner select_scanner(void)
+{
+#ifdef DIFF_AVX2
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return vector_scan;
+    }
+#endif
+    return scalar_scan;
+}
+
+/*
+ * @brief This function finds the ranges where two images differ
+ * @param ranges filled with up to max_ranges ranges in ascending order
+ * @return the number of ranges, which may be more than max_ranges
+ */
+int diff_memory(const unsigned char *before, const unsigned char *after, int length, DiffRange *ranges,
+                int max_ranges)
+{
+    static chunk_scanner scan_chunks;
+    DiffScan scan = {ranges, max_ranges, 0, {0, 0, 0}};
+    int tail = length - length % DIFF_CHUNK;
+    if (scan_chunks == NULL)
+    {
+        scan_chunks = select_scanner();
+    }
+    scan_chunks(before, after, tail, &scan);
+    for (int address = tail; address < length; ++address)
+    {
+        add_differences(&scan, address, before[address] != after[address]);
+    }
+    if (scan.current.changed > 0)
+    {
+        close_range(&scan);
+    }
+    return scan.count;
+}
+
+static void print_range_bytes(const char *label, const unsigned char *memory, const DiffRange *range)
+{
+    printf("  %-8s", label);
+    for (int address = range->start; address < range->end && address < range->start + DIFF_SHOW_BYTES; ++address)
+    {
+        printf("%02x ", memory[address]);
+    }
+    printf("%s\n", range->end - range->start > DIFF_SHOW_BYTES ? "..." : "");
+}
+
+/*
+ * @brief This function prints the ranges where one bank of two images differ
+ * @param bank 'I' or 'D', printed with each range
+ * @return the number of ranges
+ */
+int print_memory_diff(char bank, const unsigned char *before, const unsigned char *after, int length)
+{
+    DiffRange ranges[DIFF_MAX_RANGES];
+    int count = diff_memory(before, after, length, ranges, DIFF_MAX_RANGES);
+    int changed = 0;
+    for (int i = 0; i < count && i < DIFF_MAX_RANGES; ++i)
+    {
+        changed += ranges[i].changed;
+        printf("%c %04x..%04x  %d bytes, %d changed\n", bank, ranges[i].start, ranges[i].end - 1,
+               ranges[i].end - ranges[i].start, ranges[i].changed);
+        print_range_bytes("before:", before, &ranges[i]);
+        print_range_bytes("after:", after, &ranges[i]);
+    }
+    if (count > DIFF_MAX_RANGES)
+    {
+        printf("%c ... %d more ranges not shown\n", bank, count - DIFF_MAX_RANGES);
+    }
+    if (count == 0)
+    {
+        printf("%c-memory is the same\n", bank);
+    }
+    else if (count <= DIFF_MAX_RANGES)
+    {
+        printf("%c-memory differs in %d ranges, %d bytes changed\n", bank, count, changed);
+    }
+    return count;
+}
+
+/*
+ * @brief This function reads a raw image of one bank, as written by export_memory, images shorter than a bank
+ * cover the bank from address 0
+ * @return the length of the image, or -1 if it could not be read
+ */
+int read_memory_image(const char *path, Memory *bank)
+{
+    FILE *image = fopen(path, "rb");
+    size_t length;
+    if (image == NULL)
+    {
+        return -1;
+    }
+    length = fread(bank->byte, 1, BYTE_MEMORY_SIZE, image);
+    fclose(image);
+    return (int)length;
+}
+
+/*
+ * @brief This function compares one bank of live memory with a raw image file
+ * @return the number of differing ranges, or -1 if the image could not be read
+ */
+int diff_memory_image(int mem_type, const char *path)
+{
+    Memory *image = malloc(sizeof(Memory));
+    int length;
+    int count = -1;
+    if (image == NULL)
+    {
+        return -1;
+    }
+    length = read_memory_image(path, image);
+    if (length >= 0)
+    {
+        count = print_memory_diff(mem_type == INSTR ? 'I' : 'D', image->byte, xm23_memory[mem_type].byte, length);
+    }
+    free(image);
+    return count;
+}
+
+/*
+ * @brief This function saves a snapshot of both banks or compares memory with the snapshot or an image file
+ */
+void memory_diff_menu(Emulator *emulator)
+{
+    char command;
+    char mem_type;
+    char file_name[MAX_RECORD_LEN];
+    printf("Enter S to save a snapshot, C to compare memory with it, or F I|D <file> to compare a bank with a raw "
+           "image: ");
+    if (scanf(" %c", &command) != 1)
+    {
+        return;
+    }
+    switch (toupper(command))
+    {
+        case 'S':
+            memcpy(snapshot, xm23_memory, sizeof(snapshot));
+            snapshot_saved = true;
+            printf("Snapshot saved at clock %lu\n", emulator->clock);
+            break;
+        case 'C':
+            if (!snapshot_saved)
+            {
+                printf("No snapshot saved\n");
+                break;
+            }
+            print_memory_diff('I', snapshot[INSTR].byte, xm23_memory[INSTR].byte, BYTE_MEMORY_SIZE);
+            print_memory_diff('D', snapshot[DATA].byte, xm23_memory[DATA].byte, BYTE_MEMORY_SIZE);
+            break;
+        case 'F':
+            if (scanf(" %c %70s", &mem_type, file_name) != 2 || (toupper(mem_type) != 'I' && toupper(mem_type) != 'D'))
+            {
+                printf("Enter the bank (I/D) and the image file after F\n");
+                break;
+            }
+            if (diff_memory_image(toupper(mem_type) == 'I' ? INSTR : DATA, file_name) < 0)
+            {
+                printf("Could not read %s\n", file_name);
+            }
+            break;
+        default:
+            printf("Invalid diff command\n");
+            break;
+    }
+}
@@ -0,0 +1,259 @@
+/*
+ * File Name: memory_export.c
+ * Date October 19 2026
+ * Module Info: This module writes memory out quickly, as the hex dump display_loader_memory shows, as raw binary, or
+ * as S-records the loader can read back. Lines are formatted through lookup tables into a large buffer that is
+ * written with one write call per EXPORT_BUFFER_SIZE bytes instead of a printf per byte.
+ */
+#include "emulation.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define EXPORT_BUFFER_SIZE (1 << 16)
+#define DUMP_LINE_MAX 128 //address, 16 "xx, " entries, the gap and 16 characters
+#define DUMP_GAP "       "
+#define RECORD_DATA_BYTES 16 //42 characters, well under the loader's record limit
+
+typedef struct export_buffer
+{
+    int fd;
+    size_t length;
+    bool failed;
+    char data[EXPORT_BUFFER_SIZE];
+}ExportBuffer;
+
+static char hex_pairs[256][2]; //the two lowercase hex digits of each byte
+static char printable[256]; //the byte, or '.' if isprint rejects it
+static bool tables_ready;
+
+static void init_export_tables(void)
+{
+    static const char digits[] = "0123456789abcdef";
+    if (tables_ready)
+    {
+        return;
+    }
+    for (int byte = 0; byte < 256; ++byte)
+    {
+        hex_pairs[byte][0] = digits[byte >> 4];
+        hex_pairs[byte][1] = digits[byte & 0x0F];
+        printable[byte] = isprint(byte) ? (char)byte : '.';
+    }
+    tables_ready = true;
+}
+
+static void flush_export(ExportBuffer *buffer)
+{
+    ssize_t written;
+    size_t offset = 0;
+    while (offset < buffer->length && !buffer->failed)
+    {
+        written = write(buffer->fd, buffer->data + offset, buffer->length - offset);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        buffer->failed = written <= 0;
+        offset += written > 0 ? (size_t)written : 0;
+    }
+    buffer->length = 0;
+}
+
+/*
+ * @brief This function returns space for up to length more bytes, flushing the buffer first if they do not fit
+ */
+static char *export_space(ExportBuffer *buffer, size_t length)
+{
+    if (buffer->length + length > EXPORT_BUFFER_SIZE)
+    {
+        flush_export(buffer);
+    }
+    return buffer->data + buffer->length;
+}
+
+static char *put_hex_byte(char *out, unsigned char byte)
+{
+    memcpy(out, hex_pairs[byte], 2);
+    return out + 2;
+}
+
+/*
+ * @brief This function writes one dump line, the address, each byte as "xx, " and the bytes as characters,
+ * lines that start or end part way through 16 bytes are padded so the characters still line up
+ */
+static void dump_line(ExportBuffer *buffer, const unsigned char *memory, int address, int count)
+{
+    char *start = export_space(buffer, DUMP_LINE_MAX);
+    char *out = start;
+    int column = address % MEMORY_LINE_LENGTH;
+    out = put_hex_byte(out, (unsigned char)(address >> 8));
+    out = put_hex_byte(out, (unsigned char)address);
+    *out++ = ':';
+    *out++ = ' ';
+    memset(out, ' ', column * 4);
+    out += column * 4;
+    for (int i = 0; i < count; ++i)
+    {
+        out = put_hex_byte(out, memory[address + i]);
+        *out++ = ',';
+        *out++ = ' ';
+    }
+    memset(out, ' ', (MEMORY_LINE_LENGTH - column - count) * 4);
+    out += (MEMORY_LINE_LENGTH - column - count) * 4;
+    memcpy(out, DUMP_GAP, sizeof(DUMP_GAP) - 1);
+    out += sizeof(DUMP_GAP) - 1;
+    for (int i = 0; i < count; ++i)
+    {
+        *out++ = printable[memory[address + i]];
+    }
+    *out++ = '\n';
+    buffer->length += (size_t)(out - start);
+}
+
+/*
+ * @brief This function writes one S-record with the length and checksum test_checksum expects
+ */
+static void write_record(ExportBuffer *buffer, char type, unsigned short address, const unsigned char *data,
+                         int length)
+{
+    char *start = export_space(buffer, DUMP_LINE_MAX);
+    char *out = start;
+    unsigned char sum = (unsigned char)(length + RECORD_OVERHEAD) + (address >> 8) + (address & 0xFF);
+    *out++ = 'S';
+    *out++ = type;
+    out = put_hex_byte(out, (unsigned char)(length + RECORD_OVERHEAD));
+    out = put_hex_byte(out, (unsigned char)(address >> 8));
+    out = put_hex_byte(out, (unsigned char)address);
+    for (int i = 0; i < length; ++i)
+    {
+        out = put_hex_byte(out, data[i]);
+        sum += data[i];
+    }
+    out = put_hex_byte(out, (unsigned char)~sum);
+    //the loader reads hex case blind, upper case matches what the assembler writes
+    for (char *digit = start + 2; digit < out; ++digit)
+    {
+        *digit = (char)toupper(*digit);
+    }
+    *out++ = '\n';
+    buffer->length += (size_t)(out - start);
+}
+
+static bool all_zero(const unsigned char *data, int length)
+{
+    for (int i = 0; i < length; ++i)
+    {
+        if (data[i] != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * @brief This function exports memory from lower up to, but not including, upper
+ * @param fd where to write, the caller opens and closes it, stdout must be flushed first
+ * @param mem_type INSTR or DATA
+ * @param start_address written in the S9 record of an S-record export
+ * @return false if writing failed
+ */
+bool export_memory(int fd, int mem_type, int lower, int upper, EXPORT_FORMATS format, unsigned short start_address)
+{
+    ExportBuffer *buffer = malloc(sizeof(ExportBuffer));
+    const unsigned char *memory = xm23_memory[mem_type].byte;
+    int count;
+    bool failed;
+    if (buffer == NULL)
+    {
+        return false;
+    }
+    init_export_tables();
+    buffer->fd = fd;
+    buffer->length = 0;
+    buffer->failed = false;
+    switch (format)
+    {
+        case EXPORT_HEX_DUMP:
+            for (int address = lower; address < upper; address += count)
+            {
+                count = MEMORY_LINE_LENGTH - address % MEMORY_LINE_LENGTH;
+                count = count < upper - address ? count : upper - address;
+                dump_line(buffer, memory, address, count);
+            }
+            break;
+        case EXPORT_RAW:
+            //large enough to go straight from memory
+            flush_export(buffer);
+            while (lower < upper && !buffer->failed)
+            {
+                count = (int)write(fd, memory + lower, (size_t)(upper - lower));
+                buffer->failed = count <= 0 && errno != EINTR;
+                lower += count > 0 ? count : 0;
+            }
+            break;
+        case EXPORT_S_RECORDS:
+            //records of zeros are left out, the loader starts from cleared memory
+            for (int address = lower; address < upper; address += count)
+            {
+                count = upper - address < RECORD_DATA_BYTES ? upper - address : RECORD_DATA_BYTES;
+                if (!all_zero(memory + address, count))
+                {
+                    write_record(buffer, mem_type == INSTR ? '1' : '2', (unsigned short)address, memory + address,
+                                 count);
+                }
+            }
+            write_record(buffer, '9', start_address, NULL, 0);
+            break;
+    }
+    flush_export(buffer);
+    failed = buffer->failed;
+    free(buffer);
+    return !failed;
+}
+
+/*
+ * @brief This function asks for a range, a format and a file and exports the memory, - writes to stdout
+ */
+void export_memory_menu(Emulator *emulator)
+{
+    int lower;
+    int upper;
+    char mem_type;
+    char format;
+    char file_name[MAX_RECORD_LEN];
+    int fd;
+    printf("Enter lower, upper (hex), memory type (I/D), format (H hex dump, R raw, S S-records) and file (- for "
+           "stdout): ");
+    if (scanf("%x %x %c %c %70s", &lower, &upper, &mem_type, &format, file_name) != 5 || lower < 0 ||
+        upper > (BYTE_MEMORY_SIZE) || lower > upper)
+    {
+        printf("Invalid export\n");
+        return;
+    }
+    format = (char)toupper(format);
+    if (format != 'H' && format != 'R' && format != 'S')
+    {
+        printf("Invalid format\n");
+        return;
+    }
+    fflush(stdout);
+    fd = strcmp(file_name, "-") == 0 ? STDOUT_FILENO : open(file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        printf("Could not open %s\n", file_name);
+        return;
+    }
+    if (!export_memory(fd, toupper(mem_type) == 'I' ? INSTR : DATA, lower, upper,
+                       format == 'H' ? EXPORT_HEX_DUMP : format == 'R' ? EXPORT_RAW : EXPORT_S_RECORDS,
+                       (unsigned short)emulator->starting_address))
+    {
+        printf("Export failed\n");
+    }
+    if (fd != STDOUT_FILENO)
+    {
+        close(fd);
+        printf("Exported %04x --> %04x to %s\n", lower, upper, file_name);
+    }
+}
@@ -0,0 +1,154 @@
+/*
+ * File Name: paged_memory.c
+ * Date October 19 2026
+ * Module Info: This module implements copy on write paged memory for running many instances of one program. A
+ * PageImage splits a loaded memory into 256 byte pages once and is shared read-only, every all-zero page pointing
+ * at the same zero page. Each instance's PagedMemory is a table of page pointers into the image, and a page is only
+ * copied into memory of its own the first time that instance writes to it, so an instance costs its page table
+ * plus the pages it has written instead of a whole Memory.
+ */
+#include "emulation.h"
+
+#define PAGE_OFFSET_MASK (PAGE_SIZE - 1)
+
+static bool page_is_zero(const unsigned char *page)
+{
+    for (int i = 0; i < PAGE_SIZE; ++i)
+    {
+        if (page[i] != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * @brief This function splits a memory into shared read-only pages
+ * @return the image, or NULL if it could not be allocated
+ */
+PageImage *create_page_image(const Memory *memory)
+{
+    PageImage *image = calloc(1, sizeof(PageImage));
+    unsigned int stored = 0;
+    if (image == NULL)
+    {
+        return NULL;
+    }
+    //one block for the zero page and every page that is not all zeros
+    image->storage = calloc(PAGE_COUNT + 1, PAGE_SIZE);
+    if (image->storage == NULL)
+    {
+        free(image);
+        return NULL;
+    }
+    for (int page = 0; page < PAGE_COUNT; ++page)
+    {
+        if (page_is_zero(&memory->byte[page * PAGE_SIZE]))
+        {
+            image->pages[page] = image->storage;
+        }
+        else
+        {
+            image->pages[page] = image->storage + ++stored * PAGE_SIZE;
+            memcpy(image->pages[page], &memory->byte[page * PAGE_SIZE], PAGE_SIZE);
+        }
+    }
+    image->stored_pages = stored;
+    return image;
+}
+
+void free_page_image(PageImage *image)
+{
+    if (image != NULL)
+    {
+        free(image->storage);
+        free(image);
+    }
+}
+
+/*
+ * @brief This function points every page of an instance's memory at the shared image
+ */
+void init_paged_memory(PagedMemory *memory, const PageImage *image)
+{
+    memory->image = image;
+    memcpy(memory->pages, image->pages, sizeof(memory->pages));
+    memory->copied_pages = 0;
+}
+
+/*
+ * @brief This function frees the pages the instance copied, the shared ones belong to the image
+ */
+void free_paged_memory(PagedMemory *memory)
+{
+    if (memory->image == NULL)
+    {
+        return;
+    }
+    for (int page = 0; page < PAGE_COUNT; ++page)
+    {
+        if (memory->pages[page] != memory->image->pages[page])
+        {
+            free(memory->pages[page]);
+            memory->pages[page] = memory->image->pages[page];
+        }
+    }
+    memory->copied_pages = 0;
+}
+
+/*
+ * @brief This function returns a page the instance may write to, copying the shared page on the first write
+ */
+static unsigned char *writable_page(PagedMemory *memory, unsigned short address)
+{
+    unsigned int page = address >> PAGE_SHIFT;
+    if (memory->pages[page] == memory->image->pages[page])
+    {
+        memory->pages[page] = malloc(PAGE_SIZE);
+        if (memory->pages[page] == NULL)
+        {
+            printf("Out of memory copying a page, exiting program, FATAL ERROR\n");
+            exit(-1);
+        }
+        memcpy(memory->pages[page], memory->image->pages[page], PAGE_SIZE);
+        memory->copied_pages++;
+    }
+    return memory->pages[page];
+}
+
+/*
+ * @brief word accesses ignore the low address bit, the same as indexing Memory.word with address >> 1
+ */
+unsigned short paged_read_word(const PagedMemory *memory, unsigned short address)
+{
+    unsigned short value;
+    memcpy(&value, memory->pages[address >> PAGE_SHIFT] + (address & PAGE_OFFSET_MASK & ~1), sizeof(value));
+    return value;
+}
+
+unsigned char paged_read_byte(const PagedMemory *memory, unsigned short address)
+{
+    return memory->pages[address >> PAGE_SHIFT][address & PAGE_OFFSET_MASK];
+}
+
+void paged_write_word(PagedMemory *memory, unsigned short address, unsigned short value)
+{
+    memcpy(writable_page(memory, address) + (address & PAGE_OFFSET_MASK & ~1), &value, sizeof(value));
+}
+
+void paged_write_byte(PagedMemory *memory, unsigned short address, unsigned char value)
+{
+    writable_page(memory, address)[address & PAGE_OFFSET_MASK] = value;
+}
+
+/*
+ * @brief This function copies an instance's whole memory out, for dumps and comparisons
+ */
+void read_paged_memory(const PagedMemory *memory, Memory *out)
+{
+    for (int page = 0; page < PAGE_COUNT; ++page)
+    {
+        memcpy(&out->byte[page * PAGE_SIZE], memory->pages[page], PAGE_SIZE);
+    }
+}
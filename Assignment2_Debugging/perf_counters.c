@@ -0,0 +1,147 @@
+/*
+ * File Name: perf_counters.c
+ * Date October 19 2026
+ * Module Info: This module implements a performance counter device that guest programs read with LD, so a
+ * benchmark can time its own regions without the emulator printing anything. While the device is mapped it
+ * replaces the top 64 bytes of D-memory, the memory underneath is left alone and comes back when it is unmapped.
+ *
+ * Register map, counters are 64 bits held in four words with the least significant word first:
+ *   FFC0  CLOCK      emulator clock of the E1 cycle that performs the read, the clock printed by the trace
+ *   FFC8  RETIRED    instructions executed, including the LD/ST doing the access and any fast-forwarded ones
+ *   FFD0  BUBBLES    decode and execute bubbles
+ *   FFD8  LATCH      a write copies all three counters into the snapshot, a read gives the number of latches
+ *   FFE0  the snapshot of CLOCK, RETIRED and BUBBLES, unchanged until the next write to LATCH
+ *   FFF8  reserved, reads as 0
+ * Reading a live counter word takes the value at that read, so a 64 bit value read with four LDs can tear across a
+ * carry. Latching first and reading the snapshot gives all four words of every counter from the same clock.
+ */
+#include "emulation.h"
+
+#define PERF_COUNTER_BYTES 8
+#define PERF_LATCH 0x18
+#define PERF_SNAPSHOT 0x20
+#define PERF_RESERVED 0x38
+
+static uint64_t counter_value(Emulator *emulator, int counter)
+{
+    switch (counter)
+    {
+        case PERF_CLOCK:
+            return emulator->clock;
+        case PERF_RETIRED:
+            return emulator->stats.retired + emulator->sampling.fast_forwarded;
+        default:
+            return emulator->stats.decode_bubbles + emulator->stats.execute_bubbles;
+    }
+}
+
+/*
+ * @brief This function gives the byte of the register map at an offset from PERF_COUNTER_BASE
+ */
+static unsigned char register_byte(Emulator *emulator, unsigned short offset)
+{
+    PerfCounterDevice *device = &emulator->perf_counters;
+    uint64_t value;
+    if (offset < PERF_LATCH)
+    {
+        value = counter_value(emulator, offset / PERF_COUNTER_BYTES);
+    }
+    else if (offset < PERF_SNAPSHOT)
+    {
+        value = offset < PERF_LATCH + 2 ? device->latches & 0xFFFF : 0;
+    }
+    else if (offset < PERF_RESERVED)
+    {
+        value = device->snapshot[(offset - PERF_SNAPSHOT) / PERF_COUNTER_BYTES];
+    }
+    else
+    {
+        return 0;
+    }
+    return (unsigned char)(value >> (8 * (offset % PERF_COUNTER_BYTES)));
+}
+
+void latch_perf_counters(Emulator *emulator)
+{
+    for (int counter = 0; counter < PERF_COUNTERS; ++counter)
+    {
+        emulator->perf_counters.snapshot[counter] = counter_value(emulator, counter);
+    }
+    emulator->perf_counters.latches++;
+}
+
+/*
+ * @brief This function performs the data access the memory controller was given when its address is in the device,
+ * word accesses ignore the low address bit like D-memory does
+ */
+void perf_counter_access(Emulator *emulator)
+{
+    unsigned short offset = emulator->d_control.DMAR - PERF_COUNTER_BASE;
+    switch (emulator->xCTRL)
+    {
+        case D_READ:
+            offset &= ~1;
+            emulator->d_control.DMBR = register_byte(emulator, offset) | register_byte(emulator, offset + 1) << 8;
+            break;
+        case D_READ_B:
+            emulator->d_control.DMBR = register_byte(emulator, offset);
+            break;
+        case D_WRITE:
+        case D_WRITE_B:
+            //the counters are read only, only LATCH takes writes
+            if ((offset & ~1) == PERF_LATCH)
+            {
+                latch_perf_counters(emulator);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * @brief This function prints the counters as the guest would read them now and the last snapshot
+ */
+void print_perf_counters(Emulator *emulator)
+{
+    static const char *counter_names[PERF_COUNTERS] = {"CLOCK", "RETIRED", "BUBBLES"};
+    printf("== Performance Counters (%s at %04X, %lu latches) ==\n",
+           emulator->perf_counters.mapped ? "mapped" : "not mapped", PERF_COUNTER_BASE,
+           emulator->perf_counters.latches);
+    printf("COUNTER  LIVE                  SNAPSHOT\n");
+    for (int counter = 0; counter < PERF_COUNTERS; ++counter)
+    {
+        printf("%-8s %-21llu %llu\n", counter_names[counter], (unsigned long long)counter_value(emulator, counter),
+               (unsigned long long)emulator->perf_counters.snapshot[counter]);
+    }
+}
+
+/*
+ * @brief This function maps or unmaps the performance counters and prints them
+ */
+void perf_counter_menu(Emulator *emulator)
+{
+    char command;
+    printf("Enter E to map the performance counters at %04X, O to unmap them, R to print them: ", PERF_COUNTER_BASE);
+    if (scanf(" %c", &command) != 1)
+    {
+        return;
+    }
+    switch (toupper(command))
+    {
+        case 'E':
+            emulator->perf_counters.mapped = true;
+            printf("Performance counters mapped at %04X..FFFF\n", PERF_COUNTER_BASE);
+            break;
+        case 'O':
+            emulator->perf_counters.mapped = false;
+            printf("Performance counters unmapped\n");
+            break;
+        case 'R':
+            print_perf_counters(emulator);
+            break;
+        default:
+            printf("Invalid performance counter command\n");
+            break;
+    }
+}
@@ -0,0 +1,298 @@
+/*
+ * File Name: pipeline_model.c
+ * Date October 19 2026
+ * Module Info: This module implements trace driven timing models of candidate pipelines. Each instruction retired by
+ * the emulator is replayed through every configured model, which tracks when each register result becomes usable
+ * and charges stalls for data hazards, load-use hazards and control transfers. The emulator itself is unchanged,
+ * so any number of configurations can be measured from one run of a real guest program.
+ *
+ * Stage layout used by the models, one instruction may enter fetch per cycle:
+ *   2 stage: F E         (XM23p, the load completes in E1 alongside the next decode)
+ *   3 stage: F D E       (registers read in D, loads take one more cycle after E)
+ *   5 stage: F D E M W   (registers read in D, written in the first half of W)
+ * Branches and PC writes resolve at the end of E.
+ */
+#include "emulation.h"
+
+#define READ_STAGE 1
+#define EXECUTE_STAGE(depth) ((depth) == 2 ? 1 : 2)
+#define LOAD_LATENCY(depth) ((depth) == 2 ? 0 : 1)
+#define WRITEBACK_STAGE 4 //only the 5 stage pipeline has its own writeback stage
+#define REG_BIT(reg) (1 << (reg))
+
+static const char *stall_names[STALL_CAUSES] = {"data", "load_use", "control"};
+
+/*
+ * @brief This function finds the registers the decoded instruction reads and writes
+ * @param reads bitmask of registers read, bit n for Rn
+ * @param writes bitmask of registers written
+ */
+void register_usage(Emulator *emulator, unsigned char *reads, unsigned char *writes)
+{
+    unsigned char dest = REG_BIT(emulator->inst_operands.dest);
+    unsigned char source = REG_BIT(emulator->inst_operands.source_const);
+    bool auto_index = emulator->inst_operands.inc || emulator->inst_operands.dec;
+    *reads = 0;
+    *writes = 0;
+    switch (emulator->opcode)
+    {
+        case bl:
+            *writes = REG_BIT(LINK_REG);
+            break;
+        case add ... bis:
+            *reads = dest | (emulator->inst_operands.register_or_constant == REGISTER ? source : 0);
+            *writes = (emulator->opcode == cmp || emulator->opcode == bit) ? 0 : dest;
+            break;
+        case mov:
+            *reads = source;
+            *writes = dest;
+            break;
+        case swap:
+            *reads = source | dest;
+            *writes = source | dest;
+            break;
+        case sra ... sxt:
+            *reads = dest;
+            *writes = dest;
+            break;
+        case ld:
+            *reads = source;
+            *writes = dest | (auto_index ? source : 0);
+            break;
+        case st:
+            *reads = source | dest;
+            *writes = auto_index ? dest : 0;
+            break;
+        case ldr:
+            *reads = source;
+            *writes = dest;
+            break;
+        case str:
+            *reads = source | dest;
+            break;
+        case movl:
+        case movh:
+            //only one byte is replaced so the old value is needed
+            *reads = dest;
+            *writes = dest;
+            break;
+        case movlz:
+        case movls:
+            *writes = dest;
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * @brief first cycle the register file holds a result, for consumers without a forwarding path
+ */
+static unsigned long int register_file_ready(unsigned char depth, unsigned long int start, bool is_load)
+{
+    if (depth == 5)
+    {
+        return start + WRITEBACK_STAGE;
+    }
+    //no writeback stage, results are written at the end of E and loads one cycle later
+    return start + EXECUTE_STAGE(depth) + 1 + (is_load ? LOAD_LATENCY(depth) : 0);
+}
+
+/*
+ * @brief first cycle a consumer can be in E with the result of an instruction that started at start
+ */
+static unsigned long int result_ready(PipelineConfig *config, unsigned long int start, bool is_load)
+{
+    unsigned char execute = EXECUTE_STAGE(config->depth);
+    unsigned long int from_register_file = register_file_ready(config->depth, start, is_load) + execute - READ_STAGE;
+    unsigned long int forwarded = start + execute + 1 + (is_load ? LOAD_LATENCY(config->depth) : 0);
+    if (config->forwarding && forwarded < from_register_file)
+    {
+        return forwarded;
+    }
+    return from_register_file;
+}
+
+/*
+ * @brief This function advances one model by a single retired instruction
+ */
+static void advance_model(PipelineModel *model, unsigned short address, unsigned char reads, unsigned char writes,
+                          unsigned char load_writes)
+{
+    PipelineConfig *config = &model->config;
+    unsigned char execute = EXECUTE_STAGE(config->depth);
+    unsigned long int start = model->instructions ? model->last_start + 1 : 0;
+    unsigned long int needed;
+
+    //a retired instruction that does not follow the last one means fetch was redirected when it resolved in E
+    if (model->instructions && address != (unsigned short)(model->last_address + 2))
+    {
+        needed = model->last_start + execute + 1;
+        if (needed > start)
+        {
+            model->stalls[STALL_CONTROL] += needed - start;
+            start = needed;
+        }
+    }
+    for (int reg = 0; reg < REGFILE_SIZE; ++reg)
+    {
+        if (!(reads & REG_BIT(reg)))
+        {
+            continue;
+        }
+        needed = model->reg_ready[reg];
+        if (model->reg_from_load[reg] && !config->load_use_interlock)
+        {
+            //no interlock, the hardware reads whatever is there and the guest code has to cover the delay
+            if (needed > start + execute)
+            {
+                model->unprotected_load_use++;
+            }
+            needed = model->reg_ready_no_load[reg];
+        }
+        if (needed > start + execute)
+        {
+            model->stalls[model->reg_from_load[reg] ? STALL_LOAD_USE : STALL_DATA] += needed - (start + execute);
+            start = needed - execute;
+        }
+    }
+    for (int reg = 0; reg < REGFILE_SIZE; ++reg)
+    {
+        if (writes & REG_BIT(reg))
+        {
+            model->reg_from_load[reg] = load_writes & REG_BIT(reg);
+            model->reg_ready[reg] = result_ready(config, start, model->reg_from_load[reg]);
+            model->reg_ready_no_load[reg] = result_ready(config, start, false);
+        }
+    }
+    model->last_start = start;
+    model->last_address = address;
+    model->instructions++;
+}
+
+/*
+ * @brief This function replays the instruction entering E0 through every configured pipeline model
+ */
+void model_instruction(Emulator *emulator)
+{
+    unsigned char reads;
+    unsigned char writes;
+    unsigned char load_writes = 0;
+    register_usage(emulator, &reads, &writes);
+    if (emulator->opcode == ld || emulator->opcode == ldr)
+    {
+        load_writes = REG_BIT(emulator->inst_operands.dest);
+    }
+    for (int i = 0; i < emulator->pipeline_model_count; ++i)
+    {
+        advance_model(&emulator->pipeline_models[i], emulator->execute_address, reads, writes, load_writes);
+    }
+}
+
+/*
+ * @brief This function adds a model to the set replayed each instruction
+ * @return false if the configuration is invalid or the set is full
+ */
+bool add_pipeline_model(Emulator *emulator, PipelineConfig config)
+{
+    if (config.depth != 2 && config.depth != 3 && config.depth != 5)
+    {
+        printf("Pipeline depth must be 2, 3 or 5\n");
+        return false;
+    }
+    if (emulator->pipeline_model_count == MAX_PIPELINE_MODELS)
+    {
+        printf("Only %d pipeline models can be measured at once\n", MAX_PIPELINE_MODELS);
+        return false;
+    }
+    memset(&emulator->pipeline_models[emulator->pipeline_model_count], 0, sizeof(PipelineModel));
+    emulator->pipeline_models[emulator->pipeline_model_count++].config = config;
+    return true;
+}
+
+/*
+ * @brief This function asks the user for a pipeline model to add, or adds the standard set of candidates
+ */
+void configure_pipeline_models(Emulator *emulator)
+{
+    static const PipelineConfig standard_models[] = {
+            {2, true, true}, {3, false, true}, {3, true, true}, {5, false, true}, {5, true, true}, {5, true, false}
+    };
+    int depth;
+    int forwarding;
+    int interlock;
+    printf("Enter depth (2, 3, 5), forwarding (0/1), load-use interlock (0/1), or 0 for the standard set: ");
+    if (scanf("%d", &depth) != 1)
+    {
+        printf("Invalid pipeline model\n");
+        return;
+    }
+    if (depth == 0)
+    {
+        for (int i = 0; i < sizeof(standard_models) / sizeof(standard_models[0]); ++i)
+        {
+            add_pipeline_model(emulator, standard_models[i]);
+        }
+    }
+    else if (scanf("%d %d", &forwarding, &interlock) == 2)
+    {
+        add_pipeline_model(emulator, (PipelineConfig){depth, forwarding, interlock});
+    }
+    else
+    {
+        printf("Invalid pipeline model\n");
+        return;
+    }
+    printf("Measuring %d pipeline models\n", emulator->pipeline_model_count);
+}
+
+static unsigned long int model_cycles(PipelineModel *model)
+{
+    //the last instruction still has to drain through every stage
+    return model->instructions ? model->last_start + model->config.depth : 0;
+}
+
+/*
+ * @brief This function prints the cycle count and stall breakdown of each pipeline model
+ */
+void print_pipeline_models(Emulator *emulator)
+{
+    if (emulator->pipeline_model_count == 0)
+    {
+        printf("No pipeline models configured, add them with (O)\n");
+        return;
+    }
+    printf("== Pipeline Models ==\n");
+    printf("DEPTH  FWD  INTERLOCK  INSTRUCTIONS  CYCLES      CPI    DATA      LOAD-USE  CONTROL   UNPROTECTED\n");
+    for (int i = 0; i < emulator->pipeline_model_count; ++i)
+    {
+        PipelineModel *model = &emulator->pipeline_models[i];
+        unsigned long int cycles = model_cycles(model);
+        printf("%-6d %-4s %-10s %-13lu %-11lu %-6.3f %-9lu %-9lu %-9lu %lu\n", model->config.depth,
+               model->config.forwarding ? "yes" : "no", model->config.load_use_interlock ? "yes" : "no",
+               model->instructions, cycles, model->instructions ? (double)cycles / model->instructions : 0.0,
+               model->stalls[STALL_DATA], model->stalls[STALL_LOAD_USE], model->stalls[STALL_CONTROL],
+               model->unprotected_load_use);
+    }
+}
+
+/*
+ * @brief This function writes the pipeline models as a JSON array
+ */
+void write_pipeline_models_json(Emulator *emulator, FILE *out)
+{
+    fprintf(out, "[");
+    for (int i = 0; i < emulator->pipeline_model_count; ++i)
+    {
+        PipelineModel *model = &emulator->pipeline_models[i];
+        fprintf(out, "%s{\"depth\": %d, \"forwarding\": %s, \"load_use_interlock\": %s, \"instructions\": %lu, "
+                     "\"cycles\": %lu", i ? ", " : "", model->config.depth, model->config.forwarding ? "true" : "false",
+                model->config.load_use_interlock ? "true" : "false", model->instructions, model_cycles(model));
+        for (int cause = 0; cause < STALL_CAUSES; ++cause)
+        {
+            fprintf(out, ", \"%s_stalls\": %lu", stall_names[cause], model->stalls[cause]);
+        }
+        fprintf(out, ", \"unprotected_load_use\": %lu}", model->unprotected_load_use);
+    }
+    fprintf(out, "]");
+}
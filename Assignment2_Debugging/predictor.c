@@ -0,0 +1,168 @@
+/*
+ * File Name: predictor.c
+ * Date October 19 2026
+ * Module Info: This module implements the branch predictor models for the fetch stage. F0 asks the predictor for
+ * the next address to fetch, and E0 resolves each branch against the address that was actually fetched after it,
+ * flushing only when the fetched path was wrong. Architectural results are the same for every model, only the
+ * number of bubbles changes.
+ *
+ * Static not taken is the original pipeline: the predictor is bypassed and branches flush through execute_branch.
+ * The other models share a small direct mapped BTB, which supplies the target address since F0 has not seen the
+ * instruction yet. A BTB miss is always predicted not taken.
+ */
+#include "emulation.h"
+
+#define BTB_INDEX(address) (((address) >> 1) & (BTB_ENTRIES - 1))
+#define COUNTER_INDEX(address) (((address) >> 1) & (COUNTER_TABLE_SIZE - 1))
+#define STRONGLY_TAKEN 3
+#define WEAKLY_TAKEN 2
+#define WEAKLY_NOT_TAKEN 1
+
+static const char *predictor_names[PREDICTOR_COUNT] = {"static not taken", "backward taken/forward not taken",
+                                                       "1-bit counters", "2-bit counters"};
+
+const char *predictor_name(PREDICTOR_TYPES type)
+{
+    return predictor_names[type];
+}
+
+/*
+ * @brief This function predicts the address F0 should fetch after fetch_address
+ * @param fetch_address the address F0 is fetching this clock
+ * @return the predicted branch target on a BTB hit predicted taken, otherwise the next word
+ */
+unsigned short predict_next_fetch(Emulator *emulator, unsigned short fetch_address)
+{
+    BranchPredictor *predictor = &emulator->predictor;
+    BTBEntry *entry;
+    bool taken;
+    if (predictor->type == PREDICT_NOT_TAKEN)
+    {
+        return fetch_address + 2;
+    }
+    entry = &predictor->btb[BTB_INDEX(fetch_address)];
+    if (!entry->valid || entry->tag != fetch_address)
+    {
+        return fetch_address + 2;
+    }
+    switch (predictor->type)
+    {
+        case PREDICT_BTFN:
+            //loops branch backwards (or to themselves), so those are assumed taken
+            taken = entry->target <= fetch_address;
+            break;
+        case PREDICT_ONE_BIT:
+            taken = predictor->counters[COUNTER_INDEX(fetch_address)];
+            break;
+        case PREDICT_TWO_BIT:
+            taken = predictor->counters[COUNTER_INDEX(fetch_address)] >= WEAKLY_TAKEN;
+            break;
+        default:
+            taken = false;
+            break;
+    }
+    return taken ? entry->target : fetch_address + 2;
+}
+
+/*
+ * @brief This function trains the BTB and counters with the outcome of a resolved branch
+ */
+static void train_predictor(BranchPredictor *predictor, unsigned short branch_address, unsigned short target,
+                            bool taken)
+{
+    unsigned char *counter = &predictor->counters[COUNTER_INDEX(branch_address)];
+    BTBEntry *entry = &predictor->btb[BTB_INDEX(branch_address)];
+    if (taken)
+    {
+        //only taken branches are worth a BTB entry, a not taken branch is predicted the same on a miss
+        entry->valid = true;
+        entry->tag = branch_address;
+        entry->target = target;
+    }
+    switch (predictor->type)
+    {
+        case PREDICT_ONE_BIT:
+            *counter = taken;
+            break;
+        case PREDICT_TWO_BIT:
+            if (taken && *counter < STRONGLY_TAKEN)
+            {
+                (*counter)++;
+            }
+            else if (!taken && *counter > 0)
+            {
+                (*counter)--;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/*
+ * @brief This function resolves the branch in E0 when a predictor is in use. The word in F1 was fetched from
+ * IMAR, if that is not where execution continues the pipeline is flushed and fetch restarts at the right address
+ * @param taken set to the outcome of the branch
+ * @return true if the fetched path was wrong and the pipeline was flushed
+ */
+bool redirect_fetch(Emulator *emulator, bool *taken)
+{
+    unsigned short branch_address = emulator->execute_address;
+    unsigned short target = branch_address + EXECUTE_PC_OFFSET + emulator->offset;
+    unsigned short next_address;
+    bool flushed;
+
+    *taken = branch_condition(emulator);
+    next_address = *taken ? target : branch_address + 2;
+    flushed = next_address != emulator->i_control.IMAR;
+    if (flushed)
+    {
+        emulator->reg_file[REGISTER][PROG_COUNTER].word = next_address;
+        emulator->hazard_control.e_bubble = true;
+        emulator->hazard_control.d_bubble = true;
+    }
+    train_predictor(&emulator->predictor, branch_address, target, *taken);
+    return flushed;
+}
+
+/*
+ * @brief This function resolves the branch in E0 and records it in the branch profile
+ */
+void resolve_branch(Emulator *emulator)
+{
+    bool taken;
+    bool flushed = redirect_fetch(emulator, &taken);
+    record_branch(emulator, taken, flushed);
+}
+
+/*
+ * @brief This function lets the user choose the branch predictor, the tables are cleared on every change
+ * @note the predictor can only be changed before emulation starts since fetch may be on a predicted path
+ */
+void select_predictor(Emulator *emulator)
+{
+    int choice;
+    if (emulator->clock != 0)
+    {
+        printf("Branch predictor can only be changed before emulation starts\n");
+        return;
+    }
+    printf("Current predictor: %s\n", predictor_name(emulator->predictor.type));
+    for (int i = 0; i < PREDICTOR_COUNT; ++i)
+    {
+        printf("%d: %s\n", i, predictor_name(i));
+    }
+    printf("Enter predictor: ");
+    if (scanf("%d", &choice) != 1 || choice < 0 || choice >= PREDICTOR_COUNT)
+    {
+        printf("Invalid predictor\n");
+        return;
+    }
+    memset(&emulator->predictor, 0, sizeof(BranchPredictor));
+    emulator->predictor.type = choice;
+    if (choice == PREDICT_TWO_BIT)
+    {
+        memset(emulator->predictor.counters, WEAKLY_NOT_TAKEN, sizeof(emulator->predictor.counters));
+    }
+    printf("Using %s branch predictor\n", predictor_name(emulator->predictor.type));
+}
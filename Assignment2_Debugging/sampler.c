@@ -0,0 +1,298 @@
+/*
+ * File Name: sampler.c
+ * Date October 19 2026
+ * Module Info: This module is a statistical profiler cheap enough to leave on. A sample is the address of the
+ * instruction E0 executed last and the LR, taken either by a SIGPROF handler driven by setitimer at a rate in host
+ * CPU time, or by the run loop every period guest clocks with some jitter so it cannot lock onto a loop.
+ *
+ * Samples go into a single producer single consumer ring: the signal handler (or the clock trigger) writes at the
+ * head and the run loop drains from the tail into per address histograms every SAMPLE_DRAIN_CLOCKS clocks. The
+ * handler never blocks and never calls anything that is not async-signal-safe; when the ring is full the sample
+ * is counted as dropped. With sampling off the run loop pays one NULL check per clock.
+ */
+#include "emulation.h"
+#include <sys/time.h>
+
+#define SAMPLE_BUFFER_MASK (SAMPLE_BUFFER_SIZE - 1)
+#define SAMPLE_DRAIN_CLOCKS (1 << 16) //at 1 kHz and tens of MHz the ring stays nearly empty
+#define SAMPLE_REPORT_ROWS 20
+
+static Emulator *volatile sampled_emulator; //the emulator the SIGPROF handler samples
+static unsigned int jitter_state = 0x9E3779B9;
+
+/*
+ * @brief producer side of the ring, safe to call from the signal handler
+ */
+static void record_sample(SampleProfile *profile, unsigned short pc, unsigned short lr)
+{
+    unsigned int head = atomic_load_explicit(&profile->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&profile->tail, memory_order_acquire);
+    if (head - tail == SAMPLE_BUFFER_SIZE)
+    {
+        atomic_fetch_add_explicit(&profile->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    profile->buffer[head & SAMPLE_BUFFER_MASK].pc = pc;
+    profile->buffer[head & SAMPLE_BUFFER_MASK].lr = lr;
+    atomic_store_explicit(&profile->head, head + 1, memory_order_release);
+}
+
+static void sample_handler(int signal_number)
+{
+    Emulator *emulator = sampled_emulator;
+    (void)signal_number;
+    if (emulator != NULL && emulator->sample_profile != NULL)
+    {
+        record_sample(emulator->sample_profile, emulator->execute_address,
+                      emulator->reg_file[REGISTER][LINK_REG].word);
+    }
+}
+
+/*
+ * @brief consumer side of the ring, folds everything recorded so far into the histograms
+ */
+static void drain_samples(SampleProfile *profile)
+{
+    unsigned int tail = atomic_load_explicit(&profile->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&profile->head, memory_order_acquire);
+    for (; tail != head; ++tail)
+    {
+        profile->pc_counts[profile->buffer[tail & SAMPLE_BUFFER_MASK].pc >> 1]++;
+        profile->lr_counts[profile->buffer[tail & SAMPLE_BUFFER_MASK].lr >> 1]++;
+        profile->samples++;
+    }
+    atomic_store_explicit(&profile->tail, tail, memory_order_release);
+}
+
+/*
+ * @brief a clock count trigger period stretched or shrunk by up to half, xorshift keeps it cheap
+ */
+static unsigned long int jittered_period(unsigned long int period)
+{
+    jitter_state ^= jitter_state << 13;
+    jitter_state ^= jitter_state >> 17;
+    jitter_state ^= jitter_state << 5;
+    return period / 2 + jitter_state % (period + 1);
+}
+
+/*
+ * @brief This function is called by the run loop when the clock reaches next_check_clock, it takes a clock count
+ * sample or drains the ring
+ */
+void sample_clock(Emulator *emulator)
+{
+    SampleProfile *profile = emulator->sample_profile;
+    if (profile->trigger == SAMPLE_CLOCK_COUNT)
+    {
+        record_sample(profile, emulator->execute_address, emulator->reg_file[REGISTER][LINK_REG].word);
+        profile->next_check_clock = emulator->clock + jittered_period(profile->period);
+        if (emulator->clock >= profile->next_drain_clock)
+        {
+            drain_samples(profile);
+            profile->next_drain_clock = emulator->clock + SAMPLE_DRAIN_CLOCKS;
+        }
+        return;
+    }
+    drain_samples(profile);
+    profile->next_check_clock = emulator->clock + SAMPLE_DRAIN_CLOCKS;
+}
+
+static void stop_timer(void)
+{
+    struct itimerval off = {{0, 0}, {0, 0}};
+    setitimer(ITIMER_PROF, &off, NULL);
+    sampled_emulator = NULL;
+}
+
+/*
+ * @brief This function starts sampling, clearing any earlier samples
+ * @param period microseconds of host CPU time for SAMPLE_HOST_TIMER, guest clocks for SAMPLE_CLOCK_COUNT
+ * @return false if the profile could not be allocated or the timer could not be started
+ */
+bool enable_sampler(Emulator *emulator, SAMPLE_TRIGGERS trigger, unsigned long int period)
+{
+    SampleProfile *profile;
+    struct sigaction action;
+    struct itimerval timer;
+    disable_sampler(emulator);
+    if (period == 0)
+    {
+        return false;
+    }
+    profile = calloc(1, sizeof(SampleProfile));
+    if (profile == NULL || (profile->pc_counts = calloc(WORD_MEMORY_SIZE, sizeof(unsigned int))) == NULL ||
+        (profile->lr_counts = calloc(WORD_MEMORY_SIZE, sizeof(unsigned int))) == NULL)
+    {
+        if (profile != NULL)
+        {
+            free(profile->pc_counts);
+        }
+        free(profile);
+        return false;
+    }
+    atomic_init(&profile->head, 0);
+    atomic_init(&profile->tail, 0);
+    atomic_init(&profile->dropped, 0);
+    profile->trigger = trigger;
+    profile->period = period;
+    profile->next_drain_clock = emulator->clock + SAMPLE_DRAIN_CLOCKS;
+    profile->next_check_clock = emulator->clock + (trigger == SAMPLE_CLOCK_COUNT ? period : SAMPLE_DRAIN_CLOCKS);
+    emulator->sample_profile = profile;
+    if (trigger == SAMPLE_HOST_TIMER)
+    {
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = sample_handler;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        timer.it_interval.tv_sec = (time_t)(period / MICROSECONDS_PER_SECOND);
+        timer.it_interval.tv_usec = (suseconds_t)(period % MICROSECONDS_PER_SECOND);
+        timer.it_value = timer.it_interval;
+        sampled_emulator = emulator;
+        if (sigaction(SIGPROF, &action, NULL) < 0 || setitimer(ITIMER_PROF, &timer, NULL) < 0)
+        {
+            disable_sampler(emulator);
+            return false;
+        }
+    }
+    return true;
+}
+
+void disable_sampler(Emulator *emulator)
+{
+    if (emulator->sample_profile == NULL)
+    {
+        return;
+    }
+    if (emulator->sample_profile->trigger == SAMPLE_HOST_TIMER)
+    {
+        stop_timer();
+    }
+    free(emulator->sample_profile->pc_counts);
+    free(emulator->sample_profile->lr_counts);
+    free(emulator->sample_profile);
+    emulator->sample_profile = NULL;
+}
+
+static const unsigned int *sort_counts;
+static int compare_counts(const void *a, const void *b)
+{
+    unsigned int left = sort_counts[*(const unsigned short *)a];
+    unsigned int right = sort_counts[*(const unsigned short *)b];
+    return left < right ? 1 : left > right ? -1 : 0;
+}
+
+/*
+ * @brief This function prints the most sampled entries of one histogram
+ */
+static void print_hottest(Emulator *emulator, const char *title, const unsigned int *counts, unsigned long int samples,
+                          unsigned short *ranked)
+{
+    int entries = 0;
+    for (int i = 0; i < (WORD_MEMORY_SIZE); ++i)
+    {
+        if (counts[i])
+        {
+            ranked[entries++] = (unsigned short)i;
+        }
+    }
+    sort_counts = counts;
+    qsort(ranked, entries, sizeof(unsigned short), compare_counts);
+    printf("%s\nADDR  SAMPLES     SHARE\n", title);
+    for (int i = 0; i < entries && i < SAMPLE_REPORT_ROWS; ++i)
+    {
+        printf("%04X  %-10u  %5.1f%%%s\n", ranked[i] << 1, counts[ranked[i]], 100.0 * counts[ranked[i]] / samples,
+               symbol_suffix(emulator, (unsigned short)(ranked[i] << 1)));
+    }
+}
+
+/*
+ * @brief This function prints the hottest instructions, the hottest functions when symbols are loaded, and the
+ * hottest LR values, which point just past the calls the hot code was reached through
+ */
+void print_sample_report(Emulator *emulator)
+{
+    SampleProfile *profile = emulator->sample_profile;
+    unsigned short *ranked = malloc((WORD_MEMORY_SIZE) * sizeof(unsigned short));
+    unsigned int *function_counts;
+    const Symbol *symbol;
+    if (ranked == NULL)
+    {
+        printf("Failed to allocate memory for the sample report\n");
+        return;
+    }
+    drain_samples(profile);
+    printf("== Sampling Profile (%lu samples, %lu dropped, every %lu %s) ==\n", profile->samples,
+           (unsigned long int)atomic_load(&profile->dropped), profile->period,
+           profile->trigger == SAMPLE_HOST_TIMER ? "us of host CPU time" : "clocks");
+    if (profile->samples == 0)
+    {
+        free(ranked);
+        return;
+    }
+    print_hottest(emulator, "-- Instructions --", profile->pc_counts, profile->samples, ranked);
+    function_counts = emulator->symbols != NULL ? calloc(WORD_MEMORY_SIZE, sizeof(unsigned int)) : NULL;
+    if (function_counts != NULL)
+    {
+        //charge each instruction's samples to the label it falls under, code before every label stays put
+        for (int i = 0; i < (WORD_MEMORY_SIZE); ++i)
+        {
+            if (profile->pc_counts[i])
+            {
+                symbol = find_symbol(emulator->symbols, (unsigned short)(i << 1));
+                function_counts[symbol != NULL ? symbol->address >> 1 : i] += profile->pc_counts[i];
+            }
+        }
+        print_hottest(emulator, "-- Functions --", function_counts, profile->samples, ranked);
+        free(function_counts);
+    }
+    print_hottest(emulator, "-- LR (returns to) --", profile->lr_counts, profile->samples, ranked);
+    free(ranked);
+}
+
+/*
+ * @brief This function starts or stops sampling and prints the report
+ */
+void sampler_menu(Emulator *emulator)
+{
+    char command;
+    unsigned long int rate;
+    printf("Enter T <per second> for host timer samples, K <clocks> for a sample every so many clocks, O to stop, "
+           "R for the report: ");
+    if (scanf(" %c", &command) != 1)
+    {
+        return;
+    }
+    switch (toupper(command))
+    {
+        case 'T':
+        case 'K':
+            if (scanf("%lu", &rate) != 1 || rate == 0 || (toupper(command) == 'T' && rate > MICROSECONDS_PER_SECOND))
+            {
+                printf("Invalid rate\n");
+                break;
+            }
+            if (!enable_sampler(emulator, toupper(command) == 'T' ? SAMPLE_HOST_TIMER : SAMPLE_CLOCK_COUNT,
+                                toupper(command) == 'T' ? MICROSECONDS_PER_SECOND / rate : rate))
+            {
+                printf("Could not start sampling\n");
+                break;
+            }
+            printf("Sampling\n");
+            break;
+        case 'O':
+            disable_sampler(emulator);
+            printf("Sampling off\n");
+            break;
+        case 'R':
+            if (emulator->sample_profile == NULL)
+            {
+                printf("Not sampling, enter T or K first\n");
+                break;
+            }
+            print_sample_report(emulator);
+            break;
+        default:
+            printf("Invalid sampling command\n");
+            break;
+    }
+}
@@ -0,0 +1,226 @@
+/*
+ * File Name: sampling.c
+ * Date October 19 2026
+ * Module Info: This module implements sampled simulation. A functional executor runs the program an instruction
+ * at a time with no trace, statistics or profiling until a PC, clock or instruction count is reached, then the
+ * detailed pipeline in run_emulator takes over for a window of clocks, optionally alternating for the whole run.
+ *
+ * The functional executor performs the same stage operations as the two clock ticks of pipeline_clock, in the same
+ * order, so the state it leaves at an even clock (IMAR, IR, PC, xCTRL and the decoded fields for E1, the bubble
+ * flags and the predictor tables) is exactly what the detailed pipeline would have reached. Handoffs in either
+ * direction only happen on even clocks, which is where one instruction slot ends and the next begins.
+ */
+#include "emulation.h"
+
+/*
+ * @brief address of the next instruction E0 will execute, the word already fetched into IR unless a flush is
+ * pending, in which case fetch restarts at the PC
+ */
+unsigned short next_execute_address(Emulator *emulator)
+{
+    return emulator->hazard_control.d_bubble ? emulator->reg_file[REGISTER][PROG_COUNTER].word
+                                             : emulator->i_control.IMAR;
+}
+
+/*
+ * @brief This function applies a pending E1 so a load has reached its register before the state is inspected, the
+ * same thing the next even clock would do first
+ */
+void settle_pipeline(Emulator *emulator)
+{
+    if (emulator->xCTRL != I_MEMORY && emulator->xCTRL != NO_ACCESS)
+    {
+        execute_1(emulator);
+        emulator->xCTRL = NO_ACCESS;
+    }
+}
+
+/*
+ * @brief This function makes the address the next instruction executed, flushing what was fetched and restarting
+ * fetch there
+ */
+void redirect_execution(Emulator *emulator, unsigned short address)
+{
+    if (address != next_execute_address(emulator))
+    {
+        emulator->reg_file[REGISTER][PROG_COUNTER].word = address;
+        emulator->hazard_control.d_bubble = true;
+        emulator->hazard_control.e_bubble = true;
+    }
+}
+
+/*
+ * @brief true after functional_step has executed a taken branch to its own address, which nothing can leave
+ */
+bool branched_to_self(Emulator *emulator)
+{
+    return emulator->opcode <= bra && emulator->hazard_control.d_bubble &&
+           emulator->reg_file[REGISTER][PROG_COUNTER].word == emulator->execute_address;
+}
+
+/*
+ * @brief This function runs one even and odd clock pair functionally: E1, F0, D0, F1 then E0
+ * @return true if an instruction was executed, false if the slot was a flush bubble or the core is asleep
+ */
+bool functional_step(Emulator *emulator)
+{
+    bool taken;
+    bool pc_written;
+    if (emulator->xCTRL != I_MEMORY && emulator->xCTRL != NO_ACCESS)
+    {
+        execute_1(emulator);
+    }
+    if (emulator->psw.bits.sleep)
+    {
+        //a sleeping core executes nothing, the slot passes with the pipeline left as it is
+        emulator->clock += 2;
+        emulator->idle.idle_clocks += 2;
+        return false;
+    }
+    emulator->decode_address = emulator->i_control.IMAR;
+    emulator->i_control.IMAR = emulator->reg_file[REGISTER][PROG_COUNTER].word;
+    emulator->reg_file[REGISTER][PROG_COUNTER].word = predict_next_fetch(emulator, emulator->i_control.IMAR);
+    emulator->xCTRL = I_MEMORY;
+    emulator->clock += 2;
+    if (emulator->hazard_control.d_bubble)
+    {
+        emulator->hazard_control.d_bubble = false;
+        emulator->hazard_control.e_bubble = false;
+        emulator->previously_decoded = emulator->instruction_register;
+        emulator->i_control.IMBR = xm23_memory[I_MEMORY].word[emulator->i_control.IMAR >> 1];
+        emulator->instruction_register = emulator->i_control.IMBR;
+        if (emulator->caches[I_MEMORY] != NULL)
+        {
+            cache_access(emulator->caches[I_MEMORY], emulator->i_control.IMAR, false);
+        }
+        return false;
+    }
+    decode_instruction(emulator);
+    emulator->previously_decoded = emulator->instruction_register;
+    emulator->i_control.IMBR = xm23_memory[I_MEMORY].word[emulator->i_control.IMAR >> 1];
+    emulator->instruction_register = emulator->i_control.IMBR;
+    if (emulator->caches[I_MEMORY] != NULL)
+    {
+        //fetches keep warming the I-cache so the next detailed window does not start cold
+        cache_access(emulator->caches[I_MEMORY], emulator->i_control.IMAR, false);
+    }
+
+    emulator->execute_address = emulator->decode_address;
+    if (emulator->coverage != NULL)
+    {
+        RECORD_COVERAGE(emulator, emulator->execute_address);
+    }
+    if (emulator->predictor.type != PREDICT_NOT_TAKEN && emulator->opcode <= bra)
+    {
+        //keeps the predictor tables trained so the detailed window sees the same predictions
+        redirect_fetch(emulator, &taken);
+        pc_written = false;
+    }
+    else
+    {
+        pc_written = execute_instruction(emulator);
+    }
+    if (emulator->call_profile != NULL)
+    {
+        profile_calls(emulator, pc_written);
+    }
+    if (!emulator->decoded_invalid)
+    {
+        emulator->sampling.fast_forwarded++;
+    }
+    return true;
+}
+
+/*
+ * @brief This function runs the functional executor until the target is reached, ctrl-c is pressed or the clock
+ * limit is hit, then starts a new detailed window
+ * @param target the PC, the clock (the first even clock at or past it) or the number of instructions
+ */
+void fast_forward(Emulator *emulator, FAST_FORWARD_MODES mode, unsigned long int target)
+{
+    SamplingConfig *sampling = &emulator->sampling;
+    unsigned long int executed = 0;
+    while (!stop_loop && (emulator->clock_limit == 0 || emulator->clock < emulator->clock_limit))
+    {
+        if ((mode == FAST_FORWARD_TO_PC && next_execute_address(emulator) == target) ||
+            (mode == FAST_FORWARD_TO_CLOCK && emulator->clock >= target) ||
+            (mode == FAST_FORWARD_INSTRUCTIONS && executed >= target) || emulator->psw.bits.sleep)
+        {
+            //a sleeping core is left to the detailed loop, which sleeps it to the next event or halts
+            break;
+        }
+        executed += functional_step(emulator);
+    }
+    sampling->window_start = emulator->clock;
+    sampling->windows++;
+    if (!emulator->is_quiet)
+    {
+        printf("Fast-forwarded %lu instructions, detailed window %lu starts at clock %lu with PC %04X\n", executed,
+               sampling->windows, emulator->clock, next_execute_address(emulator));
+    }
+}
+
+/*
+ * @brief This function is called after every detailed clock to end the window once it has run its length,
+ * fast-forwarding to the next window when sampling periodically
+ * @return true if the run should stop because the last window has ended
+ */
+bool sample_window_elapsed(Emulator *emulator)
+{
+    SamplingConfig *sampling = &emulator->sampling;
+    if (sampling->mode == FAST_FORWARD_OFF || sampling->window_clocks == 0 || emulator->clock % 2 != 0 ||
+        emulator->clock - sampling->window_start < sampling->window_clocks)
+    {
+        return false;
+    }
+    if (sampling->period_instructions == 0)
+    {
+        return true;
+    }
+    fast_forward(emulator, FAST_FORWARD_INSTRUCTIONS, sampling->period_instructions);
+    return false;
+}
+
+/*
+ * @brief This function asks the user how to fast-forward and how long the detailed windows are
+ */
+void configure_sampling(Emulator *emulator)
+{
+    SamplingConfig *sampling = &emulator->sampling;
+    int mode;
+    memset(sampling, 0, sizeof(SamplingConfig));
+    printf("Fast-forward mode (0 off, 1 to PC, 2 to clock, 3 instruction count): ");
+    if (scanf("%d", &mode) != 1 || mode < FAST_FORWARD_OFF || mode > FAST_FORWARD_INSTRUCTIONS)
+    {
+        printf("Invalid fast-forward mode\n");
+        return;
+    }
+    if (mode == FAST_FORWARD_OFF)
+    {
+        printf("Sampled simulation off\n");
+        return;
+    }
+    printf(mode == FAST_FORWARD_TO_PC ? "Enter PC (hex): " : "Enter target (decimal): ");
+    if (scanf(mode == FAST_FORWARD_TO_PC ? "%lx" : "%lu", &sampling->target) != 1)
+    {
+        printf("Invalid target\n");
+        return;
+    }
+    printf("Enter detailed window length in clocks (0 for the rest of the run): ");
+    if (scanf("%lu", &sampling->window_clocks) != 1)
+    {
+        printf("Invalid window length\n");
+        return;
+    }
+    if (sampling->window_clocks)
+    {
+        printf("Enter instructions to fast-forward between windows (0 for a single window): ");
+        if (scanf("%lu", &sampling->period_instructions) != 1)
+        {
+            printf("Invalid period\n");
+            return;
+        }
+    }
+    sampling->mode = mode;
+    printf("Fast-forwarding when emulation starts\n");
+}
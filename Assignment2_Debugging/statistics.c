@@ -0,0 +1,198 @@
+/*
+ * File Name: statistics.c
+ * Date October 19 2026
+ * Module Info: This module reports the pipeline statistics gathered while the emulator runs. The counters
+ * themselves are plain increments in the pipeline stages, this module only turns them into IPC and a bubble
+ * breakdown for the menu, the end of emulation, and as JSON for external tools. It also keeps the per-branch-site
+ * profile so the branches that cost the most flushes can be found.
+ */
+#include "emulation.h"
+
+#define PERCENT(part, whole) ((whole) ? (100.0 * (double)(part) / (double)(whole)) : 0.0)
+
+/*
+ * @brief instructions per clock, guarding against a run that has not clocked yet
+ */
+static double instructions_per_clock(PipelineStatistics *stats)
+{
+    return stats->clocks ? (double)stats->retired / (double)stats->clocks : 0.0;
+}
+
+/*
+ * @brief This function prints the pipeline statistics in a human readable block
+ */
+void print_statistics(Emulator *emulator)
+{
+    PipelineStatistics *stats = &emulator->stats;
+    BranchPredictor *predictor = &emulator->predictor;
+    unsigned long int total_bubbles = stats->decode_bubbles + stats->execute_bubbles;
+    unsigned long int correct = predictor->resolved - predictor->mispredicted;
+
+    printf("== Pipeline Statistics ==\n");
+    printf("Clocks:               %lu\n", stats->clocks);
+    printf("Retired Instructions: %lu\n", stats->retired);
+    printf("IPC:                  %.3f\n", instructions_per_clock(stats));
+    printf("Bubbles:              %lu (%.1f%% of clocks)\n", total_bubbles, PERCENT(total_bubbles, stats->clocks));
+    printf("  Decode (D0):        %lu (%.1f%%)\n", stats->decode_bubbles, PERCENT(stats->decode_bubbles, total_bubbles));
+    printf("  Execute (E0):       %lu (%.1f%%)\n", stats->execute_bubbles, PERCENT(stats->execute_bubbles, total_bubbles));
+    printf("Taken Branches:       %lu\n", stats->taken_branches);
+    printf("Loads:                %lu\n", stats->loads);
+    printf("Stores:               %lu\n", stats->stores);
+    printf("Invalid Instructions: %lu\n", stats->invalid_instructions);
+    printf("Branch Predictor:     %s\n", predictor_name(predictor->type));
+    printf("  Accuracy:           %.1f%% (%lu of %lu)\n", PERCENT(correct, predictor->resolved), correct,
+           predictor->resolved);
+    printf("  Cycles Saved:       %ld\n", predictor->cycles_saved);
+    if (emulator->sampling.windows)
+    {
+        //everything above covers the detailed windows only
+        printf("Fast-Forwarded:       %lu instructions (%lu detailed windows)\n", emulator->sampling.fast_forwarded,
+               emulator->sampling.windows);
+    }
+    if (emulator->idle.idle_clocks)
+    {
+        printf("Idle Clocks:          %lu (asleep or skipped in branches to themselves)\n",
+               emulator->idle.idle_clocks);
+    }
+    if (emulator->caches[I_MEMORY] != NULL || emulator->caches[D_MEMORY] != NULL)
+    {
+        print_cache_report(emulator);
+    }
+}
+
+/*
+ * @brief This function writes the pipeline statistics as a single JSON object
+ * @param out the stream to write to, stdout or an open file
+ */
+void write_statistics_json(Emulator *emulator, FILE *out)
+{
+    PipelineStatistics *stats = &emulator->stats;
+    BranchPredictor *predictor = &emulator->predictor;
+
+    fprintf(out, "{\"clocks\": %lu, \"retired\": %lu, \"ipc\": %.6f, "
+                 "\"decode_bubbles\": %lu, \"execute_bubbles\": %lu, \"taken_branches\": %lu, "
+                 "\"loads\": %lu, \"stores\": %lu, \"invalid_instructions\": %lu, "
+                 "\"predictor\": \"%s\", \"branches_resolved\": %lu, \"mispredicted\": %lu, "
+                 "\"prediction_accuracy\": %.6f, \"cycles_saved\": %ld, "
+                 "\"fast_forwarded\": %lu, \"sample_windows\": %lu, \"idle_clocks\": %lu, \"caches\": ",
+            stats->clocks, stats->retired, instructions_per_clock(stats),
+            stats->decode_bubbles, stats->execute_bubbles, stats->taken_branches,
+            stats->loads, stats->stores, stats->invalid_instructions,
+            predictor_name(predictor->type), predictor->resolved, predictor->mispredicted,
+            PERCENT(predictor->resolved - predictor->mispredicted, predictor->resolved) / 100.0,
+            predictor->cycles_saved, emulator->sampling.fast_forwarded, emulator->sampling.windows,
+            emulator->idle.idle_clocks);
+    write_caches_json(emulator, out);
+    fprintf(out, ", \"pipeline_models\": ");
+    write_pipeline_models_json(emulator, out);
+    fprintf(out, "}\n");
+}
+
+/*
+ * @brief This function asks the user for a file name and writes the statistics to it as JSON
+ */
+void export_statistics(Emulator *emulator)
+{
+    char file_name[MAX_RECORD_LEN];
+    FILE *out;
+
+    printf("Enter name of file to write statistics to:");
+    scanf("%70s", file_name);
+    out = fopen(file_name, "w");
+    if (out == NULL)
+    {
+        printf("Error opening file %s for writing\n", file_name);
+        return;
+    }
+    write_statistics_json(emulator, out);
+    fclose(out);
+    printf("Statistics written to %s\n", file_name);
+}
+
+/*
+ * @brief names for the branch opcodes, offset by one since BL is -1 in the OPCODES enum
+ */
+static const char *branch_names[] = {"BL", "BEQ", "BNE", "BC", "BNC", "BN", "BGE", "BLT", "BRA"};
+#define BRANCH_NAME(opcode) (branch_names[(opcode) - bl])
+
+/*
+ * @brief This function records one execution of the branch in E0
+ * @param taken true if the branch condition held
+ * @param flushed true if the fetched path was wrong and the pipeline was flushed
+ */
+void record_branch(Emulator *emulator, bool taken, bool flushed)
+{
+    BranchSite *site = &emulator->branch_profile[emulator->execute_address >> 1];
+    site->opcode = emulator->opcode;
+    site->executions++;
+    emulator->predictor.resolved++;
+    if (taken)
+    {
+        site->taken++;
+        emulator->stats.taken_branches++;
+        //the static pipeline flushes on every taken branch, anything a predictor avoids is saved
+        emulator->predictor.cycles_saved += FLUSH_PENALTY;
+    }
+    if (flushed)
+    {
+        site->bubble_cycles += FLUSH_PENALTY;
+        emulator->predictor.mispredicted++;
+        emulator->predictor.cycles_saved -= FLUSH_PENALTY;
+    }
+}
+
+static BranchSite *sort_profile;
+/*
+ * @brief qsort comparison placing the most expensive branch sites first, ties broken by execution count
+ */
+static int compare_branch_sites(const void *a, const void *b)
+{
+    BranchSite *site_a = &sort_profile[*(const unsigned short *)a];
+    BranchSite *site_b = &sort_profile[*(const unsigned short *)b];
+    if (site_a->bubble_cycles != site_b->bubble_cycles)
+    {
+        return site_a->bubble_cycles < site_b->bubble_cycles ? 1 : -1;
+    }
+    if (site_a->executions != site_b->executions)
+    {
+        return site_a->executions < site_b->executions ? 1 : -1;
+    }
+    return *(const unsigned short *)a - *(const unsigned short *)b;
+}
+
+/*
+ * @brief This function prints every branch site that has executed, ranked by the cycles its flushes cost
+ */
+void print_branch_profile(Emulator *emulator)
+{
+    unsigned short *ranked = malloc((WORD_MEMORY_SIZE) * sizeof(unsigned short));
+    int site_count = 0;
+    unsigned long int total_bubbles = emulator->stats.decode_bubbles + emulator->stats.execute_bubbles;
+    if (ranked == NULL)
+    {
+        printf("Failed to allocate memory for the branch profile\n");
+        return;
+    }
+    for (int i = 0; i < (WORD_MEMORY_SIZE); ++i)
+    {
+        if (emulator->branch_profile[i].executions)
+        {
+            ranked[site_count++] = i;
+        }
+    }
+    sort_profile = emulator->branch_profile;
+    qsort(ranked, site_count, sizeof(unsigned short), compare_branch_sites);
+
+    printf("== Branch Profile (%d sites) ==\n", site_count);
+    printf("RANK  ADDR  TYPE  EXECUTED     TAKEN   TAKEN%%   BUBBLE CLKS  %%BUBBLES%s\n",
+           emulator->symbols != NULL ? "  SYMBOL" : "");
+    for (int i = 0; i < site_count; ++i)
+    {
+        BranchSite *site = &emulator->branch_profile[ranked[i]];
+        printf("%-5d %04X  %-4s  %-10lu %-10lu %5.1f%%  %-12lu %5.1f%%%s\n", i + 1, ranked[i] << 1,
+               BRANCH_NAME(site->opcode), site->executions, site->taken, PERCENT(site->taken, site->executions),
+               site->bubble_cycles, PERCENT(site->bubble_cycles, total_bubbles),
+               symbol_suffix(emulator, (unsigned short)(ranked[i] << 1)));
+    }
+    free(ranked);
+}
@@ -0,0 +1,310 @@
+/*
+ * File Name: symbols.c
+ * Date October 19 2026
+ * Module Info: This module reads the labels out of the assembler's .lis listing so traces, profiles and breakpoints
+ * can show and take names instead of raw addresses. Labels come from the listing's label table (REL entries) and
+ * from the label column of lines that emit a word.
+ *
+ * The table is kept sorted by address and found with a binary search for the last label at or before an address.
+ * Traces ask for neighbouring addresses one after another, so the label found last is checked first and most
+ * lookups never search. A second index sorted by name serves breakpoints given as labels.
+ */
+#include "emulation.h"
+
+#define MAX_LISTING_LINE 512
+#define LISTING_WORD_DIGITS 4
+#define MAX_LABEL_TYPE 8
+#define MAX_SYMBOL_TEXT (MAX_SYMBOL_LEN + 12) //"  <", the name, "+" and an offset, ">"
+#define INITIAL_SYMBOLS 64
+
+/*
+ * @brief This function reads the address and instruction word of a .lis line, lines that do not emit a word
+ * (comments, ORG, lines holding only a label, the label table) are not code
+ * @param source_start set to the offset just past the word
+ * @return true if the line emits a word
+ */
+bool parse_listing_word(const char *line, unsigned int *address, int *source_start)
+{
+    int line_number;
+    unsigned int word;
+    int word_start;
+    int word_end;
+    if (sscanf(line, "%d %x %n%x%n", &line_number, address, &word_start, &word, &word_end) != 3 ||
+        word_end - word_start != LISTING_WORD_DIGITS || *address >= (BYTE_MEMORY_SIZE) ||
+        (line[word_end] != '\0' && !isspace((unsigned char)line[word_end])))
+    {
+        return false;
+    }
+    *source_start = word_end;
+    return true;
+}
+
+static bool add_symbol(SymbolTable *table, int *capacity, const char *name, unsigned int address)
+{
+    Symbol *grown;
+    if (table->count == *capacity)
+    {
+        grown = realloc(table->symbols, (size_t)*capacity * 2 * sizeof(Symbol));
+        if (grown == NULL)
+        {
+            return false;
+        }
+        table->symbols = grown;
+        *capacity *= 2;
+    }
+    table->symbols[table->count].address = (unsigned short)address;
+    snprintf(table->symbols[table->count].name, MAX_SYMBOL_LEN, "%s", name);
+    table->count++;
+    return true;
+}
+
+/*
+ * @brief This function reads a label from the source column, labels start right after the tab following the word
+ * while instructions are indented by another tab
+ */
+static bool source_label(const char *source, char *name)
+{
+    if (source[0] != '\t' || source[1] == '\0' || isspace((unsigned char)source[1]) || source[1] == ';')
+    {
+        return false;
+    }
+    return sscanf(source + 1, "%31s", name) == 1;
+}
+
+static int compare_addresses(const void *a, const void *b)
+{
+    const Symbol *left = a;
+    const Symbol *right = b;
+    return left->address != right->address ? left->address - right->address : strcmp(left->name, right->name);
+}
+
+static const SymbolTable *sort_table;
+static int compare_names(const void *a, const void *b)
+{
+    return strcmp(sort_table->symbols[*(const int *)a].name, sort_table->symbols[*(const int *)b].name);
+}
+
+/*
+ * @brief This function builds the symbol table from a .lis listing
+ * @return the table, or NULL if the listing could not be read or has no labels
+ */
+SymbolTable *load_symbols(const char *listing_path)
+{
+    FILE *listing = fopen(listing_path, "r");
+    SymbolTable *table;
+    char line[MAX_LISTING_LINE];
+    char name[MAX_SYMBOL_LEN];
+    char type[MAX_LABEL_TYPE];
+    unsigned int address;
+    unsigned int decimal;
+    int source_start;
+    int capacity = INITIAL_SYMBOLS;
+    int kept = 0;
+    bool in_label_table = false;
+    bool ok = true;
+
+    if (listing == NULL)
+    {
+        return NULL;
+    }
+    table = calloc(1, sizeof(SymbolTable));
+    if (table == NULL || (table->symbols = malloc(capacity * sizeof(Symbol))) == NULL)
+    {
+        free(table);
+        fclose(listing);
+        return NULL;
+    }
+    while (ok && fgets(line, sizeof(line), listing) != NULL)
+    {
+        if (strncmp(line, "Labels", strlen("Labels")) == 0)
+        {
+            //data labels are D-memory addresses, only code labels belong with I-memory
+            in_label_table = strstr(line, "Data") == NULL;
+        }
+        else if (in_label_table)
+        {
+            if (sscanf(line, "%31s %7s %x %u", name, type, &address, &decimal) == 4 && strcmp(type, "REL") == 0 &&
+                address == decimal && address < (BYTE_MEMORY_SIZE))
+            {
+                ok = add_symbol(table, &capacity, name, address);
+            }
+        }
+        else if (parse_listing_word(line, &address, &source_start) && source_label(line + source_start, name))
+        {
+            ok = add_symbol(table, &capacity, name, address);
+        }
+    }
+    fclose(listing);
+    if (!ok || table->count == 0)
+    {
+        free_symbols(table);
+        return NULL;
+    }
+    //labels usually appear in both the listing and the label table, keep one of each
+    qsort(table->symbols, table->count, sizeof(Symbol), compare_addresses);
+    for (int i = 0; i < table->count; ++i)
+    {
+        if (kept == 0 || compare_addresses(&table->symbols[kept - 1], &table->symbols[i]) != 0)
+        {
+            table->symbols[kept++] = table->symbols[i];
+        }
+    }
+    table->count = kept;
+    table->by_name = malloc(table->count * sizeof(int));
+    if (table->by_name == NULL)
+    {
+        free_symbols(table);
+        return NULL;
+    }
+    for (int i = 0; i < table->count; ++i)
+    {
+        table->by_name[i] = i;
+    }
+    sort_table = table;
+    qsort(table->by_name, table->count, sizeof(int), compare_names);
+    return table;
+}
+
+void free_symbols(SymbolTable *table)
+{
+    if (table == NULL)
+    {
+        return;
+    }
+    free(table->symbols);
+    free(table->by_name);
+    free(table);
+}
+
+/*
+ * @brief This function finds the last label at or before an address
+ * @return the label, or NULL if the address is before every label
+ */
+const Symbol *find_symbol(SymbolTable *table, unsigned short address)
+{
+    int low = 0;
+    int high;
+    int middle;
+    int last = table->last_found;
+    if (table->symbols[last].address <= address &&
+        (last + 1 == table->count || table->symbols[last + 1].address > address))
+    {
+        return &table->symbols[last];
+    }
+    if (table->symbols[0].address > address)
+    {
+        return NULL;
+    }
+    //the last label at or before the address is in [low, high)
+    high = table->count;
+    while (high - low > 1)
+    {
+        middle = low + (high - low) / 2;
+        if (table->symbols[middle].address <= address)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    table->last_found = low;
+    return &table->symbols[low];
+}
+
+/*
+ * @brief This function finds the address of a label
+ * @return false if there is no label with that name
+ */
+bool find_symbol_address(const SymbolTable *table, const char *name, unsigned short *address)
+{
+    int low = 0;
+    int high = table->count;
+    int middle;
+    int order;
+    while (low < high)
+    {
+        middle = low + (high - low) / 2;
+        order = strcmp(name, table->symbols[table->by_name[middle]].name);
+        if (order == 0)
+        {
+            *address = table->symbols[table->by_name[middle]].address;
+            return true;
+        }
+        if (order < 0)
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+    return false;
+}
+
+/*
+ * @brief This function names an address for traces and reports as "  <label>" or "  <label+offset>"
+ * @return the text, valid until the next call, or "" when no symbols are loaded or no label comes before it
+ */
+const char *symbol_suffix(Emulator *emulator, unsigned short address)
+{
+    static char text[MAX_SYMBOL_TEXT];
+    const Symbol *symbol;
+    if (emulator->symbols == NULL || (symbol = find_symbol(emulator->symbols, address)) == NULL)
+    {
+        return "";
+    }
+    if (symbol->address == address)
+    {
+        snprintf(text, sizeof(text), "  <%s>", symbol->name);
+    }
+    else
+    {
+        snprintf(text, sizeof(text), "  <%s+%X>", symbol->name, address - symbol->address);
+    }
+    return text;
+}
+
+/*
+ * @brief This function reads an I-memory address given as a label or in hex
+ * @return false if the text is neither
+ */
+bool parse_code_address(Emulator *emulator, const char *text, int *address)
+{
+    unsigned short symbol_address;
+    char *end;
+    long value;
+    if (emulator->symbols != NULL && find_symbol_address(emulator->symbols, text, &symbol_address))
+    {
+        *address = symbol_address;
+        return true;
+    }
+    value = strtol(text, &end, 16);
+    if (end == text || *end != '\0' || value < 0 || value >= (BYTE_MEMORY_SIZE))
+    {
+        return false;
+    }
+    *address = (int)value;
+    return true;
+}
+
+/*
+ * @brief This function loads the symbols of the .lis listing next to a .xme file, replacing any loaded before
+ * @return false if there is no listing or it has no labels, the loaded program then has no symbols
+ */
+bool load_listing_symbols(Emulator *emulator, const char *xme_path)
+{
+    char listing_path[MAX_LISTING_LINE];
+    const char *extension = strrchr(xme_path, '.');
+    int stem = extension != NULL && strchr(extension, '/') == NULL ? (int)(extension - xme_path) : (int)strlen(xme_path);
+    free_symbols(emulator->symbols);
+    snprintf(listing_path, sizeof(listing_path), "%.*s.lis", stem, xme_path);
+    emulator->symbols = load_symbols(listing_path);
+    if (emulator->symbols != NULL && !emulator->is_quiet)
+    {
+        printf("Loaded %d symbols from %s\n", emulator->symbols->count, listing_path);
+    }
+    return emulator->symbols != NULL;
+}
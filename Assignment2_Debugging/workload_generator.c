@@ -0,0 +1,366 @@
+/*
+ * File Name: workload_generator.c
+ * Date October 19 2026
+ * Module Info: This module is the entry point of the workload generator, which writes synthetic XM23p programs as
+ * .xme files for stress testing and benchmarking. The program body is a random sequence drawn from a weighted
+ * instruction mix, wrapped in an outer loop so it runs for as many clocks as the benchmark needs.
+ *
+ * Usage: XM23p_Workload_Generator -o out.xme [-n words] [-m mix] [-t taken%] [-i iterations] [-s seed] [-a origin]
+ *   -n  program size in words, up to the full 32K word I-memory (default 1024)
+ *   -m  instruction mix weights, e.g. arith=40,dadd=5,branch=20,mem=20,mov=15 (the default)
+ *   -t  percentage of branches that are taken (default 50)
+ *   -i  outer loop iterations, 0 loops forever (default 0)
+ *
+ * Register use in the generated program:
+ *   R0, R1, R5, R6  data registers for arithmetic, loads and stores
+ *   R2              address of the top of the loop
+ *   R3              outer loop counter
+ *   R4              data pointer for LD/ST, reset to DATA_POINTER every iteration
+ *
+ * Loop layout:
+ *   origin:  MOVLZ/MOVH R2 <- top, MOVLZ/MOVH R3 <- iterations
+ *   top:     MOVLZ/MOVH R4 <- DATA_POINTER
+ *            body
+ *            SUB #1,R3 / BEQ done / MOV R2,PC / BRA $   (only MOV R2,PC when looping forever)
+ *   done:    BRA $
+ * Each branch in the body is a SETCC or CLRCC Z followed by a BEQ or BNE over two filler instructions, so its
+ * outcome is fixed per site and the taken rate across sites matches -t. Every taken branch flushes, whatever its
+ * target. Branches skip two words so the loop exit BEQ can step over both the MOV R2,PC and the first BRA $. The
+ * body branches do the same so a seed still generates the same program as before.
+ */
+#include "emulation.h"
+#include <getopt.h>
+#include <time.h>
+
+#define RECORD_DATA_BYTES 16 //well under the loaders 71 character record limit
+#define DEFAULT_WORDS 1024
+#define DEFAULT_TAKEN 50
+#define DATA_POINTER 0x8000 //middle of D-memory so both directions of auto-index have room
+#define LOOP_START_REG 2
+#define COUNTER_REG 3
+#define POINTER_REG 4
+#define PROLOGUE_WORDS 4
+#define LOOP_TOP_WORDS 2
+#define FINITE_EPILOGUE_WORDS 5
+#define FOREVER_EPILOGUE_WORDS 1
+#define BRANCH_UNIT_WORDS 4
+#define WORD_ACCESS 0
+
+//instruction encodings, operand fields are ORed in
+#define ARITHMETIC_BASE 0x4000
+#define MOV_BASE 0x4C00
+#define MOVL_BASE 0x6000
+#define LD_BASE 0x5800
+#define ST_BIT 0x0400
+#define PRE_BIT 0x0200
+#define DEC_BIT 0x0100
+#define INC_BIT 0x0080
+#define SETCC_Z 0x4DA2
+#define CLRCC_Z 0x4DC2
+#define BEQ_SKIP_TWO 0x2002
+#define BNE_SKIP_TWO 0x2402
+#define BRA_SELF 0x3FFF
+#define SUB_ONE(reg) (0x4288 | (reg))
+#define BYTE_OPERAND(byte, reg) (((byte) << 3) | (reg))
+#define OPERANDS(rc, wb, source, dest) (((rc) << 7) | ((wb) << 6) | ((source) << 3) | (dest))
+
+typedef enum
+{
+    MIX_ARITHMETIC = 0,
+    MIX_DADD = 1,
+    MIX_BRANCH = 2,
+    MIX_MEMORY = 3,
+    MIX_MOV = 4,
+    MIX_CLASSES = 5
+}MIX_CLASS;
+
+static const char *mix_names[MIX_CLASSES] = {"arith", "dadd", "branch", "mem", "mov"};
+static const unsigned char data_regs[] = {0, 1, 5, 6};
+#define DATA_REG() (data_regs[rand() % sizeof(data_regs)])
+
+typedef struct workload
+{
+    unsigned short *words;
+    int count;
+    int weights[MIX_CLASSES];
+    int weight_total;
+    int taken_percent;
+    unsigned long int class_counts[MIX_CLASSES];
+    unsigned long int taken_branches;
+}Workload;
+
+static void emit(Workload *workload, unsigned short word)
+{
+    workload->words[workload->count++] = word;
+}
+
+static void emit_move_immediate(Workload *workload, unsigned char reg, unsigned short value)
+{
+    emit(workload, MOVL_BASE | (movlz - movl) << 11 | BYTE_OPERAND(value & 0xFF, reg));
+    emit(workload, MOVL_BASE | (movh - movl) << 11 | BYTE_OPERAND(value >> 8, reg));
+}
+
+/*
+ * @brief a random arithmetic instruction between data registers, DADD is left to its own class
+ */
+static unsigned short random_arithmetic(void)
+{
+    OPCODES opcode;
+    do
+    {
+        opcode = add + rand() % (bis - add + 1);
+    } while (opcode == dadd);
+    return ARITHMETIC_BASE | (opcode - add) << 8 | OPERANDS(rand() & 1, rand() & 1, DATA_REG(), DATA_REG());
+}
+
+static unsigned short random_load_store(void)
+{
+    //direct, post-inc, post-dec, pre-inc or pre-dec, words only so the pointer stays aligned
+    static const unsigned short modes[] = {0, INC_BIT, DEC_BIT, PRE_BIT | INC_BIT, PRE_BIT | DEC_BIT};
+    unsigned short mode = modes[rand() % (sizeof(modes) / sizeof(modes[0]))];
+    if (rand() & 1)
+    {
+        return LD_BASE | mode | OPERANDS(0, WORD_ACCESS, POINTER_REG, DATA_REG());
+    }
+    return LD_BASE | ST_BIT | mode | OPERANDS(0, WORD_ACCESS, DATA_REG(), POINTER_REG);
+}
+
+static MIX_CLASS random_class(Workload *workload)
+{
+    int draw = rand() % workload->weight_total;
+    for (int i = 0; i < MIX_CLASSES; ++i)
+    {
+        if (draw < workload->weights[i])
+        {
+            return i;
+        }
+        draw -= workload->weights[i];
+    }
+    return MIX_ARITHMETIC;
+}
+
+/*
+ * @brief This function fills the loop body with instructions drawn from the mix
+ * @param body_words number of words the body must occupy
+ */
+static void generate_body(Workload *workload, int body_words)
+{
+    int end = workload->count + body_words;
+    MIX_CLASS class;
+    bool taken;
+    bool use_bne;
+    while (workload->count < end)
+    {
+        class = random_class(workload);
+        if (class == MIX_BRANCH && end - workload->count < BRANCH_UNIT_WORDS)
+        {
+            class = MIX_ARITHMETIC;
+        }
+        workload->class_counts[class]++;
+        switch (class)
+        {
+            case MIX_ARITHMETIC:
+                emit(workload, random_arithmetic());
+                break;
+            case MIX_DADD:
+                emit(workload, ARITHMETIC_BASE | (dadd - add) << 8 | OPERANDS(rand() & 1, rand() & 1, DATA_REG(),
+                                                                                DATA_REG()));
+                break;
+            case MIX_BRANCH:
+                taken = rand() % 100 < workload->taken_percent;
+                use_bne = rand() & 1;
+                workload->taken_branches += taken;
+                //BEQ is taken with Z set, BNE with Z clear
+                emit(workload, taken != use_bne ? SETCC_Z : CLRCC_Z);
+                emit(workload, use_bne ? BNE_SKIP_TWO : BEQ_SKIP_TWO);
+                emit(workload, random_arithmetic());
+                emit(workload, random_arithmetic());
+                break;
+            case MIX_MEMORY:
+                emit(workload, random_load_store());
+                break;
+            case MIX_MOV:
+                emit(workload, MOVL_BASE | (rand() % (movh - movl + 1)) << 11 | BYTE_OPERAND(rand() & 0xFF, DATA_REG()));
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+/*
+ * @brief This function builds the whole program: prologue, loop top, body and epilogue
+ * @return false if the program does not fit in the requested size
+ */
+static bool generate_program(Workload *workload, unsigned short origin, int total_words, unsigned short iterations)
+{
+    int overhead = PROLOGUE_WORDS + LOOP_TOP_WORDS + (iterations ? FINITE_EPILOGUE_WORDS : FOREVER_EPILOGUE_WORDS);
+    unsigned short loop_top = origin + PROLOGUE_WORDS * 2;
+    if (total_words <= overhead)
+    {
+        fprintf(stderr, "Program must be more than %d words\n", overhead);
+        return false;
+    }
+    emit_move_immediate(workload, LOOP_START_REG, loop_top);
+    emit_move_immediate(workload, COUNTER_REG, iterations);
+    emit_move_immediate(workload, POINTER_REG, DATA_POINTER);
+    generate_body(workload, total_words - overhead);
+    if (iterations)
+    {
+        emit(workload, SUB_ONE(COUNTER_REG));
+        emit(workload, BEQ_SKIP_TWO);
+    }
+    emit(workload, MOV_BASE | OPERANDS(0, WORD_ACCESS, LOOP_START_REG, PROG_COUNTER));
+    if (iterations)
+    {
+        //the first BRA $ is only fetched behind the MOV and flushed, BEQ lands on the second
+        emit(workload, BRA_SELF);
+        emit(workload, BRA_SELF);
+    }
+    return true;
+}
+
+/*
+ * @brief This function writes one S-record with the length and checksum test_checksum expects
+ */
+static void write_record(FILE *out, char type, unsigned short address, const unsigned char *data, int length)
+{
+    unsigned char sum = length + 3 + (address >> 8) + (address & 0xFF);
+    fprintf(out, "S%c%02X%04X", type, length + 3, address);
+    for (int i = 0; i < length; ++i)
+    {
+        sum += data[i];
+        fprintf(out, "%02X", data[i]);
+    }
+    fprintf(out, "%02X\n", (unsigned char)~sum);
+}
+
+static void write_xme(FILE *out, const char *name, Workload *workload, unsigned short origin)
+{
+    unsigned char data[RECORD_DATA_BYTES];
+    int byte_count = workload->count * 2;
+    int length;
+    write_record(out, '0', 0, (const unsigned char *)name, strnlen(name, RECORD_DATA_BYTES));
+    for (int offset = 0; offset < byte_count; offset += RECORD_DATA_BYTES)
+    {
+        length = byte_count - offset < RECORD_DATA_BYTES ? byte_count - offset : RECORD_DATA_BYTES;
+        for (int i = 0; i < length; ++i)
+        {
+            //memory is little endian
+            data[i] = (offset + i) & 1 ? workload->words[(offset + i) >> 1] >> 8 : workload->words[(offset + i) >> 1];
+        }
+        write_record(out, '1', origin + offset, data, length);
+    }
+    write_record(out, '9', origin, NULL, 0);
+}
+
+/*
+ * @brief This function parses a mix such as arith=40,branch=20, classes left out get no weight
+ * @return false if a class name is unknown or every weight is zero
+ */
+static bool parse_mix(Workload *workload, char *mix)
+{
+    char *entry;
+    char *value;
+    int i;
+    memset(workload->weights, 0, sizeof(workload->weights));
+    workload->weight_total = 0;
+    for (entry = strtok(mix, ","); entry != NULL; entry = strtok(NULL, ","))
+    {
+        value = strchr(entry, '=');
+        if (value == NULL)
+        {
+            return false;
+        }
+        *value++ = '\0';
+        for (i = 0; i < MIX_CLASSES && strcmp(entry, mix_names[i]) != 0; ++i);
+        if (i == MIX_CLASSES)
+        {
+            fprintf(stderr, "Unknown instruction class %s\n", entry);
+            return false;
+        }
+        workload->weights[i] = abs(atoi(value));
+        workload->weight_total += workload->weights[i];
+    }
+    return workload->weight_total > 0;
+}
+
+int main(int argc, char *argv[])
+{
+    char default_mix[] = "arith=40,dadd=5,branch=20,mem=20,mov=15";
+    char *mix = default_mix;
+    const char *output_path = NULL;
+    const char *name;
+    int total_words = DEFAULT_WORDS;
+    unsigned short iterations = 0;
+    unsigned short origin = 0;
+    unsigned int seed = (unsigned int)time(NULL);
+    int option;
+    FILE *out;
+    Workload workload = {.taken_percent = DEFAULT_TAKEN};
+
+    while ((option = getopt(argc, argv, "o:n:m:t:i:s:a:")) != -1)
+    {
+        switch (option)
+        {
+            case 'o': output_path = optarg; break;
+            case 'n': total_words = (int)strtol(optarg, NULL, 0); break;
+            case 'm': mix = optarg; break;
+            case 't': workload.taken_percent = atoi(optarg); break;
+            case 'i': iterations = (unsigned short)strtoul(optarg, NULL, 0); break;
+            case 's': seed = (unsigned int)strtoul(optarg, NULL, 0); break;
+            case 'a': origin = (unsigned short)strtoul(optarg, NULL, 16) & ~1; break;
+            default:
+                output_path = NULL;
+                optind = argc;
+                break;
+        }
+    }
+    if (output_path == NULL)
+    {
+        fprintf(stderr, "Usage: %s -o out.xme [-n words] [-m arith=40,dadd=5,branch=20,mem=20,mov=15] [-t taken%%] "
+                        "[-i iterations] [-s seed] [-a origin]\n", argv[0]);
+        return 2;
+    }
+    if (!parse_mix(&workload, mix))
+    {
+        fprintf(stderr, "Invalid instruction mix\n");
+        return 2;
+    }
+    if (total_words > (WORD_MEMORY_SIZE) - origin / 2)
+    {
+        fprintf(stderr, "Program of %d words does not fit in I-memory from %04X\n", total_words, origin);
+        return 2;
+    }
+    workload.words = calloc(total_words, sizeof(unsigned short));
+    if (workload.words == NULL)
+    {
+        fprintf(stderr, "Failed to allocate program memory\n");
+        return 1;
+    }
+    srand(seed);
+    if (!generate_program(&workload, origin, total_words, iterations))
+    {
+        free(workload.words);
+        return 2;
+    }
+    out = fopen(output_path, "w");
+    if (out == NULL)
+    {
+        fprintf(stderr, "Error opening file %s for writing\n", output_path);
+        free(workload.words);
+        return 1;
+    }
+    name = strrchr(output_path, '/') ? strrchr(output_path, '/') + 1 : output_path;
+    write_xme(out, name, &workload, origin);
+    fclose(out);
+
+    fprintf(stderr, "Wrote %d words to %s (seed %u)\n", workload.count, output_path, seed);
+    for (int i = 0; i < MIX_CLASSES; ++i)
+    {
+        fprintf(stderr, "  %-7s %lu\n", mix_names[i], workload.class_counts[i]);
+    }
+    fprintf(stderr, "  taken branches %lu of %lu\n", workload.taken_branches, workload.class_counts[MIX_BRANCH]);
+    free(workload.words);
+    return 0;
+}